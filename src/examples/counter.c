@@ -0,0 +1,85 @@
+/* counter.c
+
+   Forks several processes that each increment a counter in
+   shared memory many times, serialized by a mutex built on
+   futex_wait() and futex_wake(), then checks the total.
+
+   The mutex word is 0 when unlocked, 1 when locked, and 2 when
+   locked with possible waiters, so locking and unlocking only
+   enter the kernel when there is contention. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+#define PROCS 4
+#define ROUNDS 1000
+
+struct shared
+  {
+    int mutex;
+    int counter;
+  };
+
+static void
+mutex_lock (int *m)
+{
+  int c = __sync_val_compare_and_swap (m, 0, 1);
+
+  if (c == 0)
+    return;
+  if (c != 2)
+    c = __sync_lock_test_and_set (m, 2);
+  while (c != 0)
+    {
+      futex_wait (m, 2);
+      c = __sync_lock_test_and_set (m, 2);
+    }
+}
+
+static void
+mutex_unlock (int *m)
+{
+  if (__sync_fetch_and_sub (m, 1) != 1)
+    {
+      *m = 0;
+      futex_wake (m, 1);
+    }
+}
+
+int
+main (void)
+{
+  struct shared *s = shm_attach ("counter", 1);
+  int i;
+
+  if (s == NULL)
+    {
+      printf ("counter: shm_attach failed\n");
+      return 1;
+    }
+
+  for (i = 0; i < PROCS; i++)
+    {
+      pid_t pid = fork ();
+      if (pid == 0)
+        {
+          int j;
+
+          for (j = 0; j < ROUNDS; j++)
+            {
+              mutex_lock (&s->mutex);
+              s->counter++;
+              mutex_unlock (&s->mutex);
+            }
+          return 0;
+        }
+      else if (pid == PID_ERROR)
+        printf ("counter: fork failed\n");
+    }
+
+  while (wait_any (NULL) != PID_ERROR)
+    continue;
+
+  printf ("counter: %d (expected %d)\n", s->counter, PROCS * ROUNDS);
+  return s->counter == PROCS * ROUNDS ? 0 : 1;
+}
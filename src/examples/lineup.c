@@ -5,16 +5,52 @@
    Incidentally, another way to do this while avoiding the seeks
    would be to open the input file, then remove() it and reopen
    it under another handle.  Because of Unix deletion semantics
-   this works fine. */
+   this works fine.
+
+   The seek and write for each block are queued on a submission
+   ring instead of being made as system calls; the kernel
+   performs them as part of the following read. */
 
 #include <ctype.h>
 #include <stdio.h>
 #include <syscall.h>
 
+static struct sysring ring __attribute__ ((aligned (4096)));
+
+/* Queues operation OP on RING.  The expected result is passed as
+   the user data, so that completions can be checked with
+   reap(). */
+static void
+submit (enum sysring_op op, int fd, void *buf, unsigned size,
+        unsigned expect)
+{
+  struct sysring_sqe *sqe = &ring.sq[ring.sq_tail % SYSRING_ENTRIES];
+
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->size = size;
+  sqe->user_data = expect;
+  ring.sq_tail++;
+}
+
+/* Consumes the completions posted to RING so far. */
+static void
+reap (void)
+{
+  for (; ring.cq_head != ring.cq_tail; ring.cq_head++)
+    {
+      struct sysring_cqe *cqe = &ring.cq[ring.cq_head % SYSRING_ENTRIES];
+      if (cqe->result != (int) cqe->user_data)
+        printf ("write failed\n");
+    }
+}
+
 int
 main (int argc, char *argv[])
 {
   char buf[1024];
+  unsigned pos = 0;
   int handle;
 
   if (argc != 2)
@@ -24,22 +60,28 @@ main (int argc, char *argv[])
   if (handle < 0)
     exit (2);
 
+  if (!sysring_setup (&ring))
+    exit (3);
+
   for (;;) 
     {
       int n, i;
 
       n = read (handle, buf, sizeof buf);
+      reap ();
       if (n <= 0)
         break;
 
       for (i = 0; i < n; i++)
         buf[i] = toupper ((unsigned char) buf[i]);
 
-      seek (handle, tell (handle) - n);
-      if (write (handle, buf, n) != n)
-        printf ("write failed\n");
+      submit (SYSRING_SEEK, handle, NULL, pos, 0);
+      submit (SYSRING_WRITE, handle, buf, n, n);
+      pos += n;
     }
 
+  sysring_enter ();
+  reap ();
   close (handle);
 
   return EXIT_SUCCESS;
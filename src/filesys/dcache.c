@@ -0,0 +1,210 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Maximum number of cached names. */
+#define DCACHE_SIZE 256
+
+/* A cached name: the result of looking up NAME in the directory
+   whose inode is in sector DIR.  SECTOR is the sector of the
+   inode that NAME refers to, or DCACHE_NONE if DIR has no entry
+   for NAME, so that repeated lookups of names that do not exist
+   are also answered from the cache. */
+struct dentry
+  {
+    struct hash_elem hash_elem;         /* Element in dentries. */
+    struct list_elem lru_elem;          /* Element in lru. */
+    disk_sector_t dir;                  /* Sector of directory. */
+    disk_sector_t sector;               /* Sector of named inode. */
+    char name[NAME_MAX + 1];            /* Name in DIR. */
+  };
+
+/* Cached names, indexed by directory and name, and ordered from
+   most to least recently used.  Protected by dcache_lock. */
+static struct hash dentries;
+static struct list lru;
+static size_t dentry_cnt;
+static struct lock dcache_lock;
+
+/* Number of changes to any directory, counted by dcache_insert()
+   and dcache_changed().  Protected by dcache_lock. */
+static unsigned change_cnt;
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+static struct dentry *find_dentry (disk_sector_t dir, const char *name);
+static void record (disk_sector_t dir, const char *name, disk_sector_t);
+
+/* Initializes the name cache. */
+void
+dcache_init (void)
+{
+  hash_init (&dentries, dentry_hash, dentry_less, NULL);
+  list_init (&lru);
+  lock_init (&dcache_lock);
+}
+
+/* Looks up NAME in the directory whose inode is in sector DIR.
+   If the result is cached, stores the sector of NAME's inode, or
+   DCACHE_NONE if there is no such entry, into *SECTORP and
+   returns true.  Otherwise, returns false, and the caller should
+   search the directory itself and then record what it found
+   with dcache_fill(). */
+bool
+dcache_lookup (disk_sector_t dir, const char *name, disk_sector_t *sectorp)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return false;
+
+  lock_acquire (&dcache_lock);
+  d = find_dentry (dir, name);
+  if (d != NULL)
+    {
+      list_remove (&d->lru_elem);
+      list_push_front (&lru, &d->lru_elem);
+      *sectorp = d->sector;
+    }
+  lock_release (&dcache_lock);
+
+  return d != NULL;
+}
+
+/* Records that NAME, in the directory whose inode is in sector
+   DIR, refers to the inode in SECTOR, or that there is no such
+   name if SECTOR is DCACHE_NONE.  Must be called whenever an
+   entry is added to or removed from a directory, so that the
+   cache is never out of date.  Evicts the least recently used
+   name if the cache is full.  Also causes any dcache_fill() for a
+   search already in progress to be dropped. */
+void
+dcache_insert (disk_sector_t dir, const char *name, disk_sector_t sector)
+{
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  change_cnt++;
+  record (dir, name, sector);
+  lock_release (&dcache_lock);
+}
+
+/* Records that a directory has been rewritten without adding or
+   removing any names, so that searches already in progress are
+   not cached. */
+void
+dcache_changed (void)
+{
+  lock_acquire (&dcache_lock);
+  change_cnt++;
+  lock_release (&dcache_lock);
+}
+
+/* Returns a stamp to pass to dcache_fill().  Must be obtained
+   before searching a directory for a name that dcache_lookup()
+   did not find. */
+unsigned
+dcache_stamp (void)
+{
+  unsigned stamp;
+
+  lock_acquire (&dcache_lock);
+  stamp = change_cnt;
+  lock_release (&dcache_lock);
+
+  return stamp;
+}
+
+/* Records the result of searching the directory whose inode is
+   in sector DIR for NAME, as for dcache_insert(), but only if no
+   directory has changed since STAMP was obtained from
+   dcache_stamp().  Otherwise the search may have missed an entry
+   added, or found one removed, while it was in progress, and the
+   result is dropped rather than replacing a newer one. */
+void
+dcache_fill (disk_sector_t dir, const char *name, disk_sector_t sector,
+             unsigned stamp)
+{
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  if (stamp == change_cnt)
+    record (dir, name, sector);
+  lock_release (&dcache_lock);
+}
+
+/* Caches SECTOR as the result of looking up NAME in DIR,
+   evicting the least recently used name if the cache is full.
+   dcache_lock must be held. */
+static void
+record (disk_sector_t dir, const char *name, disk_sector_t sector)
+{
+  struct dentry *d;
+
+  d = find_dentry (dir, name);
+  if (d != NULL)
+    list_remove (&d->lru_elem);
+  else
+    {
+      if (dentry_cnt < DCACHE_SIZE)
+        {
+          d = malloc (sizeof *d);
+          if (d != NULL)
+            dentry_cnt++;
+        }
+      if (d == NULL && !list_empty (&lru))
+        {
+          d = list_entry (list_pop_back (&lru), struct dentry, lru_elem);
+          hash_delete (&dentries, &d->hash_elem);
+        }
+      if (d == NULL)
+        return;
+      d->dir = dir;
+      strlcpy (d->name, name, sizeof d->name);
+      hash_insert (&dentries, &d->hash_elem);
+    }
+  d->sector = sector;
+  list_push_front (&lru, &d->lru_elem);
+}
+
+/* Returns the cached name NAME in DIR, or a null pointer if it
+   is not cached.  dcache_lock must be held. */
+static struct dentry *
+find_dentry (disk_sector_t dir, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  key.dir = dir;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dentries, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Returns a hash value for dentry E. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+/* Returns true if dentry A precedes dentry B. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+  if (a->dir != b->dir)
+    return a->dir < b->dir;
+  return strcmp (a->name, b->name) < 0;
+}
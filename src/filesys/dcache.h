@@ -0,0 +1,18 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Sector recorded for a name known not to exist. */
+#define DCACHE_NONE ((disk_sector_t) -1)
+
+void dcache_init (void);
+bool dcache_lookup (disk_sector_t dir, const char *name, disk_sector_t *);
+void dcache_insert (disk_sector_t dir, const char *name, disk_sector_t);
+void dcache_changed (void);
+unsigned dcache_stamp (void);
+void dcache_fill (disk_sector_t dir, const char *name, disk_sector_t,
+                  unsigned stamp);
+
+#endif /* filesys/dcache.h */
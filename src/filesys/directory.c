@@ -1,32 +1,94 @@
 #include "filesys/directory.h"
+#include <hash.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 
+/* A single directory entry, immediately followed by the
+   NAME_LEN bytes of its name, which is not null terminated. */
+struct dir_entry 
+  {
+    disk_sector_t inode_sector;         /* Sector number of header. */
+    uint8_t name_len;                   /* Length of name. */
+  } __attribute__ ((packed));
+
+/* Number of bytes of entries in a bucket. */
+#define BUCKET_BYTES (DISK_SECTOR_SIZE - 2 * sizeof (uint16_t))
+
+/* Size of an entry with a name of typical length, used to size
+   new directories. */
+#define TYPICAL_ENTRY_SIZE (sizeof (struct dir_entry) + 14)
+
+/* A directory is an open-addressed hash table of buckets, each
+   one disk sector of entries.  An entry goes in the bucket that
+   its name hashes to or, if that bucket is full, in the next
+   bucket with room, wrapping around at the end.  OVERFLOW marks
+   a bucket that has been full at some point, so that a lookup
+   need only go on to the following bucket if the current one is
+   marked.  A lookup in a directory that is not too full thus
+   reads a single sector, however large the directory.  When
+   every bucket is full, the directory doubles in size and its
+   entries are redistributed.
+
+   Within a bucket, entries are packed one after another from the
+   start of ENTRIES, taking only as much space as their names
+   need.  Removing an entry moves the ones after it down to close
+   the gap, so the free space in a bucket is always at its end.
+   Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct dir_bucket
+  {
+    uint16_t used;                      /* Bytes of entries in use. */
+    uint16_t overflow;                  /* Nonzero if ever full. */
+    uint8_t entries[BUCKET_BYTES];      /* Packed entries. */
+  };
+
 /* A directory. */
 struct dir 
   {
     struct inode *inode;                /* Backing store. */
     off_t pos;                          /* Current position. */
-  };
 
-/* A single directory entry. */
-struct dir_entry 
-  {
-    disk_sector_t inode_sector;         /* Sector number of header. */
-    char name[NAME_MAX + 1];            /* Null terminated file name. */
-    bool in_use;                        /* In use or free? */
+    /* The bucket most recently read or written, so that looking
+       a name up and then adding or removing it reads the bucket
+       only once.  The copy is good as long as the inode's write
+       count has not changed since. */
+    struct dir_bucket *cache;           /* Cached bucket, or null. */
+    size_t cache_idx;                   /* Index of cached bucket. */
+    unsigned cache_write_cnt;           /* Inode write count at caching. */
   };
 
+/* Value of cache_idx when no bucket is cached. */
+#define NO_BUCKET SIZE_MAX
+
 /* Creates a directory with space for ENTRY_CNT entries in the
-   given SECTOR.  Returns true if successful, false on failure. */
+   given SECTOR, contained in the directory whose inode is in
+   sector PARENT.  The directory grows as entries are added
+   beyond ENTRY_CNT.  Returns true if successful, false on
+   failure. */
 bool
-dir_create (disk_sector_t sector, size_t entry_cnt) 
+dir_create (disk_sector_t sector, size_t entry_cnt, disk_sector_t parent) 
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  size_t bucket_cnt = DIV_ROUND_UP (entry_cnt * TYPICAL_ENTRY_SIZE,
+                                    BUCKET_BYTES);
+  struct inode *inode;
+
+  ASSERT (sizeof (struct dir_bucket) == DISK_SECTOR_SIZE);
+
+  if (bucket_cnt == 0)
+    bucket_cnt = 1;
+  if (!inode_create (sector, bucket_cnt * sizeof (struct dir_bucket), true))
+    return false;
+  inode = inode_open (sector);
+  if (inode == NULL)
+    return false;
+  inode_set_parent (inode, parent);
+  inode_close (inode);
+  return true;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -39,6 +101,7 @@ dir_open (struct inode *inode)
     {
       dir->inode = inode;
       dir->pos = 0;
+      dir->cache_idx = NO_BUCKET;
       return dir;
     }
   else
@@ -72,6 +135,7 @@ dir_close (struct dir *dir)
   if (dir != NULL)
     {
       inode_close (dir->inode);
+      free (dir->cache);
       free (dir);
     }
 }
@@ -83,127 +147,400 @@ dir_get_inode (struct dir *dir)
   return dir->inode;
 }
 
+/* Returns the number of buckets in DIR. */
+static size_t
+bucket_cnt (const struct dir *dir)
+{
+  return inode_length (dir->inode) / sizeof (struct dir_bucket);
+}
+
+/* Returns the bucket that NAME, which is LEN bytes long, hashes
+   to in a directory with CNT buckets. */
+static size_t
+bucket_of (const char *name, size_t len, size_t cnt)
+{
+  return hash_bytes (name, len) % cnt;
+}
+
+/* Returns the entry at byte offset OFS in bucket B. */
+static struct dir_entry *
+entry_at (struct dir_bucket *b, size_t ofs)
+{
+  return (struct dir_entry *) (b->entries + ofs);
+}
+
+/* Returns the size of entry E, including its name. */
+static size_t
+entry_size (const struct dir_entry *e)
+{
+  return sizeof *e + e->name_len;
+}
+
+/* Returns true if E is named NAME, which is LEN bytes long. */
+static bool
+entry_is (const struct dir_entry *e, const char *name, size_t len)
+{
+  return e->name_len == len && !memcmp (e + 1, name, len);
+}
+
+/* Returns true if bucket B has room for an entry whose name is
+   LEN bytes long. */
+static bool
+has_room (const struct dir_bucket *b, size_t len)
+{
+  return b->used + sizeof (struct dir_entry) + len <= BUCKET_BYTES;
+}
+
+/* Appends an entry for NAME, which is LEN bytes long, and the
+   inode in SECTOR to bucket B, which must have room for it. */
+static void
+append_entry (struct dir_bucket *b, const char *name, size_t len,
+              disk_sector_t sector)
+{
+  struct dir_entry *e = entry_at (b, b->used);
+
+  ASSERT (has_room (b, len));
+  e->inode_sector = sector;
+  e->name_len = len;
+  memcpy (e + 1, name, len);
+  b->used += entry_size (e);
+}
+
+/* Returns bucket IDX of DIR, reading it from disk unless it is
+   cached, or a null pointer if it cannot be read.  The bucket
+   stays valid until the next call for DIR. */
+static struct dir_bucket *
+read_bucket (struct dir *dir, size_t idx)
+{
+  unsigned write_cnt = inode_write_cnt (dir->inode);
+
+  if (dir->cache == NULL)
+    {
+      dir->cache = malloc (sizeof *dir->cache);
+      if (dir->cache == NULL)
+        return NULL;
+    }
+  else if (dir->cache_idx == idx && dir->cache_write_cnt == write_cnt)
+    return dir->cache;
+
+  if (inode_read_at (dir->inode, dir->cache, sizeof *dir->cache,
+                     idx * sizeof *dir->cache) != sizeof *dir->cache)
+    {
+      dir->cache_idx = NO_BUCKET;
+      return NULL; 
+    }
+  dir->cache_idx = idx;
+  dir->cache_write_cnt = write_cnt;
+  return dir->cache;
+}
+
+/* Writes back DIR's cached bucket, which must have been obtained
+   from read_bucket() and then modified.  Returns true if
+   successful, false on failure. */
+static bool
+write_bucket (struct dir *dir)
+{
+  off_t ofs = dir->cache_idx * sizeof *dir->cache;
+
+  /* Our own write leaves the cached copy current, but a failed
+     one may have left the disk holding something else. */
+  if (inode_write_at (dir->inode, dir->cache, sizeof *dir->cache, ofs)
+      != sizeof *dir->cache)
+    {
+      dir->cache_idx = NO_BUCKET;
+      return false;
+    }
+  dir->cache_write_cnt = inode_write_cnt (dir->inode);
+  return true;
+}
+
 /* Searches DIR for a file with the given NAME.
-   If successful, returns true, sets *EP to the directory entry
-   if EP is non-null, and sets *OFSP to the byte offset of the
-   directory entry if OFSP is non-null.
-   otherwise, returns false and ignores EP and OFSP. */
+   If successful, returns true, sets *SECTORP to the sector of
+   its inode if SECTORP is non-null, and leaves the bucket that
+   holds the entry in DIR's cache with the entry's offset in it
+   in *OFSP, if OFSP is non-null.
+   otherwise, returns false and ignores SECTORP and OFSP.
+   If ABSENTP is non-null, sets *ABSENTP to true if DIR was
+   searched completely and has no entry for NAME, or to false if
+   the search failed to read DIR and so proves nothing. */
 static bool
-lookup (const struct dir *dir, const char *name,
-        struct dir_entry *ep, off_t *ofsp) 
+lookup (struct dir *dir, const char *name,
+        disk_sector_t *sectorp, size_t *ofsp, bool *absentp)
 {
-  struct dir_entry e;
-  size_t ofs;
-  
+  size_t cnt = bucket_cnt (dir);
+  size_t len, first, i;
+
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (e.in_use && !strcmp (name, e.name)) 
-      {
-        if (ep != NULL)
-          *ep = e;
-        if (ofsp != NULL)
-          *ofsp = ofs;
-        return true;
-      }
+  if (absentp != NULL)
+    *absentp = false;
+  len = strlen (name);
+  if (cnt == 0 || len > NAME_MAX)
+    {
+      if (absentp != NULL)
+        *absentp = true;
+      return false;
+    }
+  first = bucket_of (name, len, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      struct dir_bucket *b = read_bucket (dir, (first + i) % cnt);
+      size_t ofs;
+
+      if (b == NULL)
+        return false;
+      for (ofs = 0; ofs < b->used; ofs += entry_size (entry_at (b, ofs)))
+        if (entry_is (entry_at (b, ofs), name, len))
+          {
+            if (sectorp != NULL)
+              *sectorp = entry_at (b, ofs)->inode_sector;
+            if (ofsp != NULL)
+              *ofsp = ofs;
+            return true;
+          }
+      if (!b->overflow)
+        break;
+    }
+  if (absentp != NULL)
+    *absentp = true;
   return false;
 }
 
+/* Returns true if NAME is "." or "..", which every directory
+   implicitly contains. */
+static bool
+is_dot (const char *name)
+{
+  return !strcmp (name, ".") || !strcmp (name, "..");
+}
+
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
+   "." names DIR itself and ".." the directory containing it.
+   Other names are looked up in the name cache first, and
+   searched for in DIR only if they are not cached.
    On success, sets *INODE to an inode for the file, otherwise to
    a null pointer.  The caller must close *INODE. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
-  struct dir_entry e;
+  disk_sector_t dir_sector, sector;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
-  else
-    *inode = NULL;
+  dir_sector = inode_get_inumber (dir->inode);
+
+  if (!strcmp (name, "."))
+    sector = dir_sector;
+  else if (!strcmp (name, ".."))
+    sector = inode_get_parent (dir->inode);
+  else if (!dcache_lookup (dir_sector, name, &sector))
+    {
+      /* Taken before DIR is read, so that the result is not
+         cached if DIR changes while we search it. */
+      unsigned stamp = dcache_stamp ();
+      bool absent;
+
+      /* Looking up a name changes only DIR's cache, which is not
+         part of its visible state. */
+      if (lookup ((struct dir *) dir, name, &sector, NULL, &absent))
+        dcache_fill (dir_sector, name, sector, stamp);
+      else
+        {
+          sector = DCACHE_NONE;
+          if (absent)
+            dcache_fill (dir_sector, name, sector, stamp);
+        }
+    }
+
+  *inode = sector != DCACHE_NONE ? inode_open (sector) : NULL;
 
   return *inode != NULL;
 }
 
+/* Doubles the number of buckets in DIR, all of which are full,
+   and redistributes its entries among them.  Returns true if
+   successful, false on failure. */
+static bool
+grow (struct dir *dir)
+{
+  size_t old_cnt = bucket_cnt (dir);
+  size_t new_cnt = old_cnt > 0 ? old_cnt * 2 : 1;
+  struct dir_bucket *old = malloc (old_cnt * sizeof *old);
+  struct dir_bucket *new = calloc (new_cnt, sizeof *new);
+  off_t new_size = new_cnt * sizeof *new;
+  bool success = false;
+  size_t i, ofs;
+
+  if (old == NULL || new == NULL
+      || (inode_read_at (dir->inode, old, old_cnt * sizeof *old, 0)
+          != (off_t) (old_cnt * sizeof *old)))
+    goto done;
+
+  for (i = 0; i < old_cnt; i++)
+    for (ofs = 0; ofs < old[i].used;
+         ofs += entry_size (entry_at (&old[i], ofs)))
+      {
+        const struct dir_entry *e = entry_at (&old[i], ofs);
+        const char *name = (const char *) (e + 1);
+        size_t idx = bucket_of (name, e->name_len, new_cnt);
+
+        while (!has_room (&new[idx], e->name_len))
+          {
+            new[idx].overflow = 1;
+            idx = (idx + 1) % new_cnt;
+          }
+        append_entry (&new[idx], name, e->name_len, e->inode_sector);
+      }
+
+  /* Write the new buckets to new sectors, so that however many
+     there are, DIR changes in a single journal commit. */
+  success = inode_replace (dir->inode, new, new_size);
+
+  /* Entries have moved, so a search that ran concurrently may
+     have missed names that DIR still contains. */
+  dcache_changed ();
+
+ done:
+  free (old);
+  free (new);
+  return success;
+}
+
 /* Adds a file named NAME to DIR, which must not already contain a
    file by that name.  The file's inode is in sector
    INODE_SECTOR.
    Returns true if successful, false on failure.
-   Fails if NAME is invalid (i.e. too long) or a disk or memory
-   error occurs. */
+   Fails if NAME is invalid (i.e. too long), if DIR has been
+   removed, or if a disk or memory error occurs. */
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) 
 {
-  struct dir_entry e;
-  off_t ofs;
-  bool success = false;
-  
+  size_t len, cnt, first, i;
+
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
   /* Check NAME for validity. */
-  if (*name == '\0' || strlen (name) > NAME_MAX)
+  len = strlen (name);
+  if (len == 0 || len > NAME_MAX || is_dot (name))
+    return false;
+
+  /* Nothing may be added to a directory that is being deleted. */
+  if (inode_is_removed (dir->inode))
     return false;
 
   /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
-    goto done;
+  if (lookup (dir, name, NULL, NULL, NULL))
+    return false;
 
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-     
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
-
-  /* Write slot. */
-  e.in_use = true;
-  strlcpy (e.name, name, sizeof e.name);
-  e.inode_sector = inode_sector;
-  success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  /* Find a bucket with a free slot, starting from the one NAME
+     hashes to and marking each full bucket passed on the way, or
+     make room if there is none. */
+  for (;;)
+    {
+      cnt = bucket_cnt (dir);
+      first = bucket_of (name, len, cnt);
+      for (i = 0; i < cnt; i++)
+        {
+          struct dir_bucket *b = read_bucket (dir, (first + i) % cnt);
 
- done:
-  return success;
+          if (b == NULL)
+            return false;
+          if (has_room (b, len))
+            {
+              append_entry (b, name, len, inode_sector);
+              if (!write_bucket (dir))
+                return false;
+              dcache_insert (inode_get_inumber (dir->inode), name,
+                             inode_sector);
+              return true;
+            }
+          if (!b->overflow)
+            {
+              b->overflow = 1;
+              if (!write_bucket (dir))
+                return false;
+            }
+        }
+      if (!grow (dir))
+        return false;
+    }
+}
+
+/* Returns true if the directory in INODE contains no entries. */
+static bool
+is_empty (struct inode *inode)
+{
+  struct dir_bucket b;
+  off_t ofs;
+
+  for (ofs = 0; ofs < inode_length (inode); ofs += sizeof b)
+    if (inode_read_at (inode, &b.used, sizeof b.used, ofs) != sizeof b.used
+        || b.used != 0)
+      return false;
+  return true;
+}
+
+/* Erases the entry for NAME, at offset OFS in the bucket in
+   DIR's cache, by moving the entries after it down over it.
+   Returns true if successful, false on failure. */
+static bool
+erase (struct dir *dir, const char *name, size_t ofs)
+{
+  struct dir_bucket *b = read_bucket (dir, dir->cache_idx);
+  struct dir_entry *e;
+  size_t size;
+
+  if (b == NULL)
+    return false;
+  e = entry_at (b, ofs);
+  size = entry_size (e);
+  memmove (e, (uint8_t *) e + size, b->used - ofs - size);
+  b->used -= size;
+  memset (b->entries + b->used, 0, size);
+  if (!write_bucket (dir))
+    return false;
+  dcache_insert (inode_get_inumber (dir->inode), name, DCACHE_NONE);
+  return true;
 }
 
 /* Removes any entry for NAME in DIR.
-   Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   Returns true if successful, false on failure, which occurs if
+   there is no file with the given NAME, or if NAME is a
+   directory that is not empty or is open, for example as some
+   process's working directory. */
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
-  struct dir_entry e;
   struct inode *inode = NULL;
   bool success = false;
-  off_t ofs;
+  disk_sector_t sector;
+  size_t ofs;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
   /* Find directory entry. */
-  if (!lookup (dir, name, &e, &ofs))
+  if (!lookup (dir, name, &sector, &ofs, NULL))
     goto done;
 
   /* Open inode. */
-  inode = inode_open (e.inode_sector);
+  inode = inode_open (sector);
   if (inode == NULL)
     goto done;
 
-  /* Erase directory entry. */
-  e.in_use = false;
-  if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
+  /* Only an unused, empty directory may be removed. */
+  if (inode_is_dir (inode)
+      && (inode_open_cnt (inode) > 1 || !is_empty (inode)))
+    goto done;
+
+  /* Erase directory entry.  Opening INODE did not write to DIR,
+     so the entry's bucket is still cached. */
+  if (!erase (dir, name, ofs))
     goto done;
 
   /* Remove inode. */
@@ -215,22 +552,68 @@ dir_remove (struct dir *dir, const char *name)
   return success;
 }
 
+/* Removes the entry for NAME from DIR without opening or
+   freeing the inode it refers to, which may be damaged.  Used by
+   the file system checker.  Returns true if successful, false
+   if there is no such entry or on failure. */
+bool
+dir_unlink (struct dir *dir, const char *name)
+{
+  size_t ofs;
+
+  ASSERT (dir != NULL);
+  ASSERT (name != NULL);
+
+  return lookup (dir, name, NULL, &ofs, NULL) && erase (dir, name, ofs);
+}
+
 /* Reads the next directory entry in DIR and stores the name in
    NAME.  Returns true if successful, false if the directory
-   contains no more entries. */
+   contains no more entries.
+
+   DIR's position is kept as a bucket number times
+   DISK_SECTOR_SIZE plus the number of entries already read from
+   that bucket, rather than as a byte offset, which removing an
+   entry could leave in the middle of another one. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
-  struct dir_entry e;
+  disk_sector_t sector;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
+  return dir_readdir_entry (dir, name, &sector);
+}
+
+/* Like dir_readdir(), but also stores the sector of the entry's
+   inode in *SECTORP, as recorded in DIR, without opening the
+   inode or otherwise checking that the sector holds one. */
+bool
+dir_readdir_entry (struct dir *dir, char name[NAME_MAX + 1],
+                   disk_sector_t *sectorp)
+{
+  for (;;)
     {
-      dir->pos += sizeof e;
-      if (e.in_use)
+      size_t idx = dir->pos / DISK_SECTOR_SIZE;
+      size_t skip = dir->pos % DISK_SECTOR_SIZE;
+      struct dir_bucket *b;
+      size_t ofs;
+
+      if (idx >= bucket_cnt (dir))
+        return false;
+      b = read_bucket (dir, idx);
+      if (b == NULL)
+        return false;
+
+      for (ofs = 0; ofs < b->used && skip > 0; skip--)
+        ofs += entry_size (entry_at (b, ofs));
+      if (ofs < b->used)
         {
-          strlcpy (name, e.name, NAME_MAX + 1);
+          struct dir_entry *e = entry_at (b, ofs);
+          memcpy (name, e + 1, e->name_len);
+          name[e->name_len] = '\0';
+          *sectorp = e->inode_sector;
+          dir->pos++;
           return true;
-        } 
+        }
+      dir->pos = (idx + 1) * DISK_SECTOR_SIZE;
     }
-  return false;
 }
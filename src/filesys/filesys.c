@@ -2,11 +2,17 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "filesys/directory.h"
 #include "devices/disk.h"
+#include "threads/thread.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
@@ -23,6 +29,8 @@ filesys_init (bool format)
     PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
   inode_init ();
+  dcache_init ();
+  journal_init (format);
   free_map_init ();
 
   if (format) 
@@ -36,24 +44,161 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+#ifdef USERPROG
+  process_forget_all_execs ();
+#endif
   free_map_close ();
+  journal_done ();
 }
 
+/* Returns the directory that relative paths are resolved
+   against: the running thread's working directory, or the root
+   directory if it has none.  The caller must close it. */
+static struct dir *
+open_cwd (void)
+{
+  struct dir *cwd = thread_current ()->cwd;
+  return cwd != NULL ? dir_reopen (cwd) : dir_open_root ();
+}
+
+/* Resolves PATH up to, but not including, its last component,
+   which it copies into NAME.  Returns the directory that should
+   contain the last component, which the caller must close, or a
+   null pointer if PATH is empty, a component is too long, or a
+   component other than the last is not an existing directory.
+   A path with no components at all, like "/", resolves to the
+   root directory, with "." as the last component.  Repeated and
+   trailing slashes are ignored. */
+static struct dir *
+open_parent (const char *path, char name[NAME_MAX + 1])
+{
+  struct dir *dir;
+  const char *cp;
+
+  if (*path == '\0')
+    return NULL;
+  dir = *path == '/' ? dir_open_root () : open_cwd ();
+  strlcpy (name, ".", NAME_MAX + 1);
+
+  for (cp = path; dir != NULL; )
+    {
+      size_t len;
+
+      while (*cp == '/')
+        cp++;
+      if (*cp == '\0')
+        break;
+      len = strcspn (cp, "/");
+      if (len > NAME_MAX)
+        {
+          dir_close (dir);
+          return NULL;
+        }
+
+      /* Descend into the directory named by the previous
+         component, now that we know there is another one. */
+      if (strcmp (name, "."))
+        {
+          struct inode *inode;
+          dir_lookup (dir, name, &inode);
+          dir_close (dir);
+          if (inode != NULL && !inode_is_dir (inode))
+            {
+              inode_close (inode);
+              inode = NULL;
+            }
+          dir = dir_open (inode);
+        }
+      memcpy (name, cp, len);
+      name[len] = '\0';
+      cp += len;
+    }
+  return dir;
+}
+
+/* Opens and returns the inode that PATH names, or a null pointer
+   if there is none. */
+static struct inode *
+open_inode (const char *path)
+{
+  char name[NAME_MAX + 1];
+  struct dir *dir = open_parent (path, name);
+  struct inode *inode = NULL;
+
+  if (dir != NULL)
+    dir_lookup (dir, name, &inode);
+  dir_close (dir);
+  return inode;
+}
+
+/* Frees SECTOR, allocated for a new inode that could not be
+   added to its directory, along with everything the inode
+   allocated if CREATED is true, meaning that it was written. */
+static void
+discard_inode (disk_sector_t sector, bool created)
+{
+  struct inode *inode = created ? inode_open (sector) : NULL;
+
+  if (inode != NULL)
+    {
+      inode_remove (inode);
+      inode_close (inode);
+    }
+  else
+    free_map_release (sector, 1);
+}
+
 /* Creates a file named NAME with the given INITIAL_SIZE.
+   NAME may be a path, absolute or relative to the running
+   thread's working directory, as may all other names below.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
    or if internal memory allocation fails. */
 bool
 filesys_create (const char *name, off_t initial_size) 
 {
+  char last[NAME_MAX + 1];
   disk_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
+  struct dir *dir = open_parent (name, last);
+  bool created = false;
+  bool success;
+
+  journal_begin ();
+  success = (dir != NULL
+             && free_map_allocate (1, &inode_sector)
+             && (created = inode_create (inode_sector, initial_size,
+                                         false))
+             && dir_add (dir, last, inode_sector));
   if (!success && inode_sector != 0) 
-    free_map_release (inode_sector, 1);
+    discard_inode (inode_sector, created);
+  journal_end ();
+  dir_close (dir);
+
+  return success;
+}
+
+/* Creates a directory named NAME.
+   Returns true if successful, false otherwise.
+   Fails if a file named NAME already exists,
+   or if internal memory allocation fails. */
+bool
+filesys_mkdir (const char *name)
+{
+  char last[NAME_MAX + 1];
+  disk_sector_t inode_sector = 0;
+  struct dir *dir = open_parent (name, last);
+  bool created = false;
+  bool success;
+
+  journal_begin ();
+  success = (dir != NULL
+             && free_map_allocate (1, &inode_sector)
+             && (created = dir_create
+                   (inode_sector, 16, inode_get_inumber (dir_get_inode (dir))))
+             && dir_add (dir, last, inode_sector));
+  if (!success && inode_sector != 0) 
+    discard_inode (inode_sector, created);
+  journal_end ();
   dir_close (dir);
 
   return success;
@@ -61,20 +206,14 @@ filesys_create (const char *name, off_t initial_size)
 
 /* Opens the file with the given NAME.
    Returns the new file if successful or a null pointer
-   otherwise.
+   otherwise.  A directory may be opened as a file, to be
+   passed to dir_open() or to have its inode examined.
    Fails if no file named NAME exists,
    or if an internal memory allocation fails. */
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
-  struct inode *inode = NULL;
-
-  if (dir != NULL)
-    dir_lookup (dir, name, &inode);
-  dir_close (dir);
-
-  return file_open (inode);
+  return file_open (open_inode (name));
 }
 
 /* Deletes the file named NAME.
@@ -84,21 +223,50 @@ filesys_open (const char *name)
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  char last[NAME_MAX + 1];
+  struct dir *dir = open_parent (name, last);
+  bool success;
+
+  journal_begin ();
+  success = dir != NULL && dir_remove (dir, last);
+  journal_end ();
   dir_close (dir); 
 
   return success;
 }
-
+
+/* Makes the directory named NAME the running thread's working
+   directory.  Returns true if successful, false if NAME does not
+   name a directory or memory allocation fails. */
+bool
+filesys_chdir (const char *name)
+{
+  struct thread *t = thread_current ();
+  struct inode *inode = open_inode (name);
+  struct dir *dir;
+
+  if (inode == NULL || !inode_is_dir (inode))
+    {
+      inode_close (inode);
+      return false;
+    }
+  dir = dir_open (inode);
+  if (dir == NULL)
+    return false;
+  dir_close (t->cwd);
+  t->cwd = dir;
+  return true;
+}
+
 /* Formats the file system. */
 static void
 do_format (void)
 {
   printf ("Formatting file system...");
   free_map_create ();
-  if (!dir_create (ROOT_DIR_SECTOR, 16))
+  if (!dir_create (ROOT_DIR_SECTOR, 16, ROOT_DIR_SECTOR))
     PANIC ("root directory creation failed");
   free_map_close ();
+  journal_flush ();
   printf ("done.\n");
 }
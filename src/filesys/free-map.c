@@ -1,13 +1,40 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <list.h>
+#include <stdio.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
 
+/* Sectors that may not be allocated: those in use according to
+   FREE_MAP, plus those freed by a change that the journal has
+   not yet committed.  A freed sector is clear in FREE_MAP, which
+   is what is written to disk, at once, but stays set in BUSY
+   until the commit that frees it has finished.  Otherwise a new
+   owner could overwrite it while, after a crash, the old one
+   would still be using it. */
+static struct bitmap *busy;
+
+/* A run of freed sectors waiting for a commit. */
+struct held_run
+  {
+    struct list_elem elem;              /* Element in held_runs. */
+    disk_sector_t sector;               /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+    unsigned commit_cnt;                /* journal_commit_cnt() at release. */
+  };
+
+/* Held runs, oldest first. */
+static struct list held_runs;
+
+static void unhold (void);
+
 /* Initializes the free map. */
 void
 free_map_init (void) 
@@ -17,6 +44,25 @@ free_map_init (void)
     PANIC ("bitmap creation failed--disk is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+
+  busy = bitmap_create (disk_size (filesys_disk));
+  if (busy == NULL)
+    PANIC ("bitmap creation failed--disk is too large");
+  bitmap_mark (busy, FREE_MAP_SECTOR);
+  bitmap_mark (busy, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (busy, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+  list_init (&held_runs);
+}
+
+/* Marks the CNT sectors starting at SECTOR as allocated, if
+   ALLOCATED is true, or as free otherwise, in both FREE_MAP and
+   BUSY. */
+static void
+set_both (disk_sector_t sector, size_t cnt, bool allocated)
+{
+  bitmap_set_multiple (free_map, sector, cnt, allocated);
+  bitmap_set_multiple (busy, sector, cnt, allocated);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -26,12 +72,17 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) 
 {
-  disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  disk_sector_t sector;
+
+  unhold ();
+  sector = bitmap_scan_and_flip (busy, 0, cnt, false);
+  if (sector != BITMAP_ERROR)
+    bitmap_set_multiple (free_map, sector, cnt, true);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+      && !bitmap_write_part (free_map, free_map_file, sector, cnt))
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
+      set_both (sector, cnt, false);
       sector = BITMAP_ERROR;
     }
   if (sector != BITMAP_ERROR)
@@ -39,13 +90,173 @@ free_map_allocate (size_t cnt, disk_sector_t *sectorp)
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Allocates the CNT sectors starting at SECTOR from the free
+   map.  Returns true if successful, false if any of them is
+   already in use or past the end of the disk. */
+bool
+free_map_allocate_at (disk_sector_t sector, size_t cnt)
+{
+  unhold ();
+  if (sector > bitmap_size (busy)
+      || cnt > bitmap_size (busy) - sector
+      || !bitmap_none (busy, sector, cnt))
+    return false;
+  set_both (sector, cnt, true);
+  if (free_map_file != NULL
+      && !bitmap_write_part (free_map, free_map_file, sector, cnt))
+    {
+      set_both (sector, cnt, false);
+      return false;
+    }
+  return true;
+}
+
+/* Extends the run of OLD_CNT allocated sectors starting at
+   SECTOR to NEW_CNT sectors, by allocating the sectors that
+   follow it.  Returns true if successful, false if any of those
+   sectors is in use or past the end of the disk. */
+bool
+free_map_extend (disk_sector_t sector, size_t old_cnt, size_t new_cnt)
+{
+  size_t add_cnt = new_cnt - old_cnt;
+
+  ASSERT (new_cnt >= old_cnt);
+  ASSERT (bitmap_all (free_map, sector, old_cnt));
+
+  unhold ();
+  if (sector + new_cnt > bitmap_size (busy)
+      || !bitmap_none (busy, sector + old_cnt, add_cnt))
+    return false;
+  set_both (sector + old_cnt, add_cnt, true);
+  if (free_map_file != NULL
+      && !bitmap_write_part (free_map, free_map_file,
+                             sector + old_cnt, add_cnt))
+    {
+      set_both (sector + old_cnt, add_cnt, false);
+      return false;
+    }
+  return true;
+}
+
+/* Makes CNT sectors starting at SECTOR available for use, once
+   the journal has committed the change that frees them.  If
+   memory is short, they stay unavailable until the next boot,
+   although they are free on disk. */
 void
 free_map_release (disk_sector_t sector, size_t cnt)
 {
+  struct held_run *r;
+
   ASSERT (bitmap_all (free_map, sector, cnt));
+  journal_revoke (sector, cnt);
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  bitmap_write_part (free_map, free_map_file, sector, cnt);
+
+  /* Read the commit count only now, so that the commit that
+     must finish is one that includes the write just made. */
+  r = malloc (sizeof *r);
+  if (r != NULL)
+    {
+      r->sector = sector;
+      r->cnt = cnt;
+      r->commit_cnt = journal_commit_cnt ();
+      list_push_back (&held_runs, &r->elem);
+    }
+}
+
+/* Makes the held runs whose frees have been committed available
+   for use. */
+static void
+unhold (void)
+{
+  unsigned commit_cnt;
+
+  if (list_empty (&held_runs))
+    return;
+  commit_cnt = journal_commit_cnt ();
+  while (!list_empty (&held_runs))
+    {
+      struct held_run *r = list_entry (list_front (&held_runs),
+                                       struct held_run, elem);
+      if (r->commit_cnt == commit_cnt)
+        break;
+      bitmap_set_multiple (busy, r->sector, r->cnt, false);
+      list_pop_front (&held_runs);
+      free (r);
+    }
+}
+
+/* Finds the first run of free sectors at or after *SECTORP.  If
+   there is one, stores its first sector into *SECTORP and its
+   length into *CNT and returns true.  Otherwise, returns
+   false. */
+bool
+free_map_next_free (disk_sector_t *sectorp, size_t *cnt)
+{
+  size_t start, end;
+
+  unhold ();
+  if (*sectorp >= bitmap_size (busy))
+    return false;
+  start = bitmap_scan (busy, *sectorp, 1, false);
+  if (start == BITMAP_ERROR)
+    return false;
+  end = bitmap_scan (busy, start, 1, true);
+  if (end == BITMAP_ERROR)
+    end = bitmap_size (busy);
+  *sectorp = start;
+  *cnt = end - start;
+  return true;
+}
+
+/* Compares the free map with USED, which has a bit set for each
+   sector that the file system checker found in use, and prints
+   each run of sectors on which they disagree.  If REPAIR is
+   true, makes the free map match USED.  Returns the number of
+   sectors on which they disagreed.  Sectors held until a commit
+   are free on disk, so they are compared as free. */
+size_t
+free_map_check (const struct bitmap *used, bool repair)
+{
+  size_t size = bitmap_size (free_map);
+  size_t bad_cnt = 0;
+  size_t i = 0;
+
+  ASSERT (bitmap_size (used) == size);
+
+  /* Let held sectors go first, so that none becomes available
+     later after being marked in use here. */
+  if (repair)
+    {
+      journal_flush ();
+      unhold ();
+    }
+
+  while (i < size)
+    {
+      bool in_use = bitmap_test (used, i);
+      size_t end;
+
+      if (bitmap_test (free_map, i) == in_use)
+        {
+          i++;
+          continue;
+        }
+      for (end = i + 1; end < size; end++)
+        if (bitmap_test (used, end) != in_use
+            || bitmap_test (free_map, end) == in_use)
+          break;
+      printf ("fsck: sectors %zu-%zu are %s but marked %s\n",
+              i, end - 1, in_use ? "in use" : "unused",
+              in_use ? "free" : "allocated");
+      if (repair)
+        set_both (i, end - i, in_use);
+      bad_cnt += end - i;
+      i = end;
+    }
+  if (repair && bad_cnt > 0 && !bitmap_write (free_map, free_map_file))
+    printf ("fsck: can't write free map\n");
+  return bad_cnt;
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -55,7 +266,8 @@ free_map_open (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
-  if (!bitmap_read (free_map, free_map_file))
+  if (!bitmap_read (free_map, free_map_file)
+      || !bitmap_read (busy, free_map_file))
     PANIC ("can't read free map");
 }
 
@@ -72,7 +284,7 @@ void
 free_map_create (void) 
 {
   /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
     PANIC ("free map creation failed");
 
   /* Write bitmap to file. */
@@ -5,6 +5,8 @@
 #include <stddef.h>
 #include "devices/disk.h"
 
+struct bitmap;
+
 void free_map_init (void);
 void free_map_read (void);
 void free_map_create (void);
@@ -12,6 +14,10 @@ void free_map_open (void);
 void free_map_close (void);
 
 bool free_map_allocate (size_t, disk_sector_t *);
+bool free_map_allocate_at (disk_sector_t, size_t);
+bool free_map_extend (disk_sector_t, size_t old_cnt, size_t new_cnt);
 void free_map_release (disk_sector_t, size_t);
+bool free_map_next_free (disk_sector_t *, size_t *cnt);
+size_t free_map_check (const struct bitmap *used, bool repair);
 
 #endif /* filesys/free-map.h */
@@ -1,12 +1,19 @@
 #include "filesys/fsutil.h"
+#include <bitmap.h>
 #include <debug.h>
+#include <inttypes.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "devices/disk.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -66,6 +73,24 @@ fsutil_rm (char **argv)
     PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Number of sectors that fsutil_put() and fsutil_get() move at
+   a time: 64 kB. */
+#define CHUNK_SECTORS 128
+#define CHUNK_SIZE (CHUNK_SECTORS * DISK_SECTOR_SIZE)
+
+/* Prints how long it took to copy SIZE bytes of FILE_NAME,
+   starting at timer tick START, and how fast that was. */
+static void
+print_throughput (const char *file_name, off_t size, int64_t start)
+{
+  int64_t ms = timer_elapsed (start) * 1000 / TIMER_FREQ;
+
+  if (ms == 0)
+    ms = 1;
+  printf ("%s: copied %"PROTd" bytes in %"PRId64" ms (%"PRId64" kB/s)\n",
+          file_name, size, ms, (int64_t) size * 1000 / 1024 / ms);
+}
+
 /* Copies from the "scratch" disk, hdc or hd1:0 to file ARGV[1]
    in the file system.
 
@@ -77,7 +102,11 @@ fsutil_rm (char **argv)
    The first call to this function will read starting at the
    beginning of the scratch disk.  Later calls advance across the
    disk.  This disk position is independent of that used for
-   fsutil_get(), so all `put's should precede all `get's. */
+   fsutil_get(), so all `put's should precede all `get's.
+
+   The file is created at its full size, so that its data is
+   allocated as one contiguous run before any of it is written,
+   and then copied CHUNK_SIZE bytes at a time. */
 void
 fsutil_put (char **argv) 
 {
@@ -86,13 +115,14 @@ fsutil_put (char **argv)
   const char *file_name = argv[1];
   struct disk *src;
   struct file *dst;
-  off_t size;
+  off_t size, total;
+  int64_t start;
   void *buffer;
 
   printf ("Putting '%s' into the file system...\n", file_name);
 
   /* Allocate buffer. */
-  buffer = malloc (DISK_SECTOR_SIZE);
+  buffer = palloc_get_multiple (0, CHUNK_SIZE / PGSIZE);
   if (buffer == NULL)
     PANIC ("couldn't allocate buffer");
 
@@ -117,19 +147,27 @@ fsutil_put (char **argv)
     PANIC ("%s: open failed", file_name);
 
   /* Do copy. */
+  start = timer_ticks ();
+  total = size;
   while (size > 0)
     {
-      int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-      disk_read (src, sector++, buffer);
+      int chunk_size = size > CHUNK_SIZE ? CHUNK_SIZE : size;
+      size_t sector_cnt = DIV_ROUND_UP (chunk_size, DISK_SECTOR_SIZE);
+      if (sector_cnt > disk_size (src) - sector)
+        PANIC ("%s: scratch disk ends with %"PROTd" bytes unread",
+               file_name, size);
+      disk_read_multiple (src, sector, sector_cnt, buffer);
+      sector += sector_cnt;
       if (file_write (dst, buffer, chunk_size) != chunk_size)
         PANIC ("%s: write failed with %"PROTd" bytes unwritten",
                file_name, size);
       size -= chunk_size;
     }
+  print_throughput (file_name, total, start);
 
   /* Finish up. */
   file_close (dst);
-  free (buffer);
+  palloc_free_multiple (buffer, CHUNK_SIZE / PGSIZE);
 }
 
 /* Copies file FILE_NAME from the file system to the scratch disk.
@@ -142,22 +180,25 @@ fsutil_put (char **argv)
    The first call to this function will write starting at the
    beginning of the scratch disk.  Later calls advance across the
    disk.  This disk position is independent of that used for
-   fsutil_put(), so all `put's should precede all `get's. */
+   fsutil_put(), so all `put's should precede all `get's.
+
+   The file is copied CHUNK_SIZE bytes at a time. */
 void
 fsutil_get (char **argv)
 {
   static disk_sector_t sector = 0;
 
   const char *file_name = argv[1];
-  void *buffer;
+  uint8_t *buffer;
   struct file *src;
   struct disk *dst;
-  off_t size;
+  off_t size, total;
+  int64_t start;
 
   printf ("Getting '%s' from the file system...\n", file_name);
 
   /* Allocate buffer. */
-  buffer = malloc (DISK_SECTOR_SIZE);
+  buffer = palloc_get_multiple (0, CHUNK_SIZE / PGSIZE);
   if (buffer == NULL)
     PANIC ("couldn't allocate buffer");
 
@@ -179,19 +220,492 @@ fsutil_get (char **argv)
   disk_write (dst, sector++, buffer);
   
   /* Do copy. */
+  start = timer_ticks ();
+  total = size;
   while (size > 0) 
     {
-      int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-      if (sector >= disk_size (dst))
+      int chunk_size = size > CHUNK_SIZE ? CHUNK_SIZE : size;
+      size_t sector_cnt = DIV_ROUND_UP (chunk_size, DISK_SECTOR_SIZE);
+      if (sector_cnt > disk_size (dst) - sector)
         PANIC ("%s: out of space on scratch disk", file_name);
       if (file_read (src, buffer, chunk_size) != chunk_size)
         PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
-      memset (buffer + chunk_size, 0, DISK_SECTOR_SIZE - chunk_size);
-      disk_write (dst, sector++, buffer);
+      memset (buffer + chunk_size, 0,
+              sector_cnt * DISK_SECTOR_SIZE - chunk_size);
+      disk_write_multiple (dst, sector, sector_cnt, buffer);
+      sector += sector_cnt;
       size -= chunk_size;
     }
+  print_throughput (file_name, total, start);
 
   /* Finish up. */
   file_close (src);
-  free (buffer);
+  palloc_free_multiple (buffer, CHUNK_SIZE / PGSIZE);
+}
+
+/* State of a file system check. */
+struct fsck
+  {
+    struct bitmap *used;        /* Sectors found in use so far. */
+    bool repair;                /* Fix problems, or just report? */
+    size_t problem_cnt;         /* Number of problems found. */
+  };
+
+/* A directory entry, as collected by check_dir(). */
+struct fsck_entry
+  {
+    disk_sector_t sector;       /* Sector of inode. */
+    char name[NAME_MAX + 1];    /* Name in directory. */
+  };
+
+/* Marks the CNT sectors starting at SECTOR as belonging to the
+   inode in sector OWNER.  Returns true if successful.  Returns
+   false, marking nothing, if any of them lies past the end of
+   the disk or already belongs to another inode. */
+static bool
+claim (struct fsck *f, disk_sector_t owner, disk_sector_t sector, size_t cnt)
+{
+  if (cnt == 0)
+    return true;
+  if (sector >= bitmap_size (f->used)
+      || cnt > bitmap_size (f->used) - sector)
+    {
+      printf ("fsck: inode %"PRDSNu": sectors %"PRDSNu"-%"PRDSNu
+              " lie past end of disk\n", owner, sector, sector + cnt - 1);
+      return false;
+    }
+  if (bitmap_any (f->used, sector, cnt))
+    {
+      printf ("fsck: inode %"PRDSNu": sectors %"PRDSNu"-%"PRDSNu
+              " are already in use\n", owner, sector, sector + cnt - 1);
+      return false;
+    }
+  bitmap_set_multiple (f->used, sector, cnt, true);
+  return true;
+}
+
+/* Checks the inode in SECTOR and claims its sectors.  Stores
+   into *IS_DIR and *PARENT whether it is a directory and, if so,
+   its parent.  Returns true if successful, false if the inode is
+   damaged or any of its sectors is already in use. */
+static bool
+check_inode (struct fsck *f, disk_sector_t sector,
+             bool *is_dir, disk_sector_t *parent)
+{
+  disk_sector_t start;
+  size_t cnt;
+
+  if (sector < bitmap_size (f->used) && bitmap_test (f->used, sector))
+    {
+      printf ("fsck: inode %"PRDSNu": sector is already in use\n", sector);
+      return false;
+    }
+  if (sector >= bitmap_size (f->used)
+      || !inode_examine (sector, &start, &cnt, is_dir, parent))
+    {
+      printf ("fsck: inode %"PRDSNu": bad inode\n", sector);
+      return false;
+    }
+  if (!claim (f, sector, start, cnt))
+    return false;
+  bitmap_mark (f->used, sector);
+  return true;
+}
+
+/* Orders fsck_entry A before fsck_entry B by inode sector. */
+static int
+compare_entries (const void *a_, const void *b_)
+{
+  const struct fsck_entry *a = a_;
+  const struct fsck_entry *b = b_;
+
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
+
+/* Checks every inode reachable from the directory whose inode,
+   already checked, is in SECTOR.  A damaged entry is reported
+   and, when repairing, removed.  The entries of each directory
+   are checked in order of inode sector, so that the disk is
+   read front to back instead of in the order of the names'
+   hashes. */
+static void
+check_dir (struct fsck *f, disk_sector_t sector)
+{
+  struct dir *dir = dir_open (inode_open (sector));
+  struct fsck_entry *entries = NULL;
+  size_t entry_cnt = 0;
+  size_t entry_max = 0;
+  char name[NAME_MAX + 1];
+  disk_sector_t entry_sector;
+  size_t i;
+
+  if (dir == NULL)
+    PANIC ("fsck: out of memory");
+
+  /* Collect the directory's entries.  Their inodes are not
+     opened, since an entry may point anywhere, even past the end
+     of the disk, until check_inode() has looked at it. */
+  while (dir_readdir_entry (dir, name, &entry_sector))
+    {
+      if (entry_cnt == entry_max)
+        {
+          entry_max = entry_max * 2 + 16;
+          entries = realloc (entries, entry_max * sizeof *entries);
+          if (entries == NULL)
+            PANIC ("fsck: out of memory");
+        }
+      entries[entry_cnt].sector = entry_sector;
+      strlcpy (entries[entry_cnt].name, name, sizeof entries->name);
+      entry_cnt++;
+    }
+  qsort (entries, entry_cnt, sizeof *entries, compare_entries);
+
+  /* Check each one. */
+  for (i = 0; i < entry_cnt; i++)
+    {
+      struct fsck_entry *e = &entries[i];
+      disk_sector_t parent;
+      bool is_dir;
+
+      if (!check_inode (f, e->sector, &is_dir, &parent))
+        {
+          printf ("fsck: entry `%s' in directory %"PRDSNu" is damaged%s\n",
+                  e->name, sector, f->repair ? ", removing" : "");
+          f->problem_cnt++;
+          if (f->repair && !dir_unlink (dir, e->name))
+            printf ("fsck: can't remove `%s'\n", e->name);
+          continue;
+        }
+      if (!is_dir)
+        continue;
+      if (parent != sector)
+        {
+          printf ("fsck: directory %"PRDSNu" has parent %"PRDSNu
+                  " instead of %"PRDSNu"%s\n", e->sector, parent, sector,
+                  f->repair ? ", fixing" : "");
+          f->problem_cnt++;
+          if (f->repair)
+            {
+              struct inode *inode = inode_open (e->sector);
+              if (inode != NULL)
+                inode_set_parent (inode, sector);
+              inode_close (inode);
+            }
+        }
+      check_dir (f, e->sector);
+    }
+
+  free (entries);
+  dir_close (dir);
+}
+
+/* Checks the file system for consistency, and repairs it if
+   REPAIR is true.  Every inode reachable from the root
+   directory must have a valid header, no sector may belong to
+   more than one inode, and the free map must mark exactly the
+   sectors in use. */
+static void
+fsck (bool repair)
+{
+  struct fsck f;
+  disk_sector_t parent;
+  bool is_dir;
+  size_t bad_cnt;
+
+  printf ("%s file system...\n", repair ? "Repairing" : "Checking");
+  f.used = bitmap_create (disk_size (filesys_disk));
+  if (f.used == NULL)
+    PANIC ("fsck: out of memory");
+  f.repair = repair;
+  f.problem_cnt = 0;
+
+  /* The journal, the free map, and the root directory are at
+     fixed locations. */
+  bitmap_set_multiple (f.used, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+  if (!check_inode (&f, FREE_MAP_SECTOR, &is_dir, &parent) || is_dir)
+    PANIC ("fsck: free map inode is damaged");
+  if (!check_inode (&f, ROOT_DIR_SECTOR, &is_dir, &parent) || !is_dir)
+    PANIC ("fsck: root directory inode is damaged");
+  check_dir (&f, ROOT_DIR_SECTOR);
+
+  /* Compare the sectors found in use with the free map.  The
+     sectors of damaged entries, which were not claimed, end up
+     free. */
+  bad_cnt = free_map_check (f.used, repair);
+  if (bad_cnt > 0)
+    f.problem_cnt++;
+  bitmap_destroy (f.used);
+  journal_flush ();
+
+  printf ("fsck: %zu problem(s) %s.\n", f.problem_cnt,
+          repair ? "repaired" : "found");
+}
+
+/* Checks the file system for consistency and reports any
+   problems found. */
+void
+fsutil_fsck (char **argv UNUSED)
+{
+  fsck (false);
+}
+
+/* Checks the file system for consistency and repairs any
+   problems found. */
+void
+fsutil_fsck_repair (char **argv UNUSED)
+{
+  fsck (true);
+}
+
+/* Function called by walk_dir() for the inode in SECTOR, which
+   PATH names. */
+typedef void visit_func (disk_sector_t sector, const char *path, void *aux);
+
+/* Calls VISIT for every inode reachable from the directory whose
+   inode is in SECTOR and which PATH, a page-sized buffer, names.
+   PATH is restored before returning. */
+static void
+walk_dir (disk_sector_t sector, char *path, visit_func *visit, void *aux)
+{
+  struct dir *dir = dir_open (inode_open (sector));
+  size_t path_len = strlen (path);
+  char name[NAME_MAX + 1];
+
+  if (dir == NULL)
+    PANIC ("%s: open failed", path);
+  while (dir_readdir (dir, name))
+    {
+      struct inode *inode;
+      disk_sector_t child;
+      bool is_dir;
+
+      if (path_len + strlen (name) + 2 > PGSIZE)
+        {
+          printf ("%s/%s: path too long, skipping\n", path, name);
+          continue;
+        }
+      if (!dir_lookup (dir, name, &inode))
+        continue;
+      child = inode_get_inumber (inode);
+      is_dir = inode_is_dir (inode);
+      inode_close (inode);
+
+      snprintf (path + path_len, PGSIZE - path_len, "/%s", name);
+      visit (child, path, aux);
+      if (is_dir)
+        walk_dir (child, path, visit, aux);
+      path[path_len] = '\0';
+    }
+  dir_close (dir);
+}
+
+/* Calls VISIT for the root directory and every inode reachable
+   from it. */
+static void
+walk (visit_func *visit, void *aux)
+{
+  char *path = palloc_get_page (PAL_ASSERT);
+
+  path[0] = '\0';
+  visit (ROOT_DIR_SECTOR, "/", aux);
+  walk_dir (ROOT_DIR_SECTOR, path, visit, aux);
+  palloc_free_page (path);
+}
+
+/* Returns the size of the largest run of free sectors. */
+static size_t
+largest_free (void)
+{
+  disk_sector_t sector = 0;
+  size_t cnt, largest = 0;
+
+  for (; free_map_next_free (&sector, &cnt); sector += cnt)
+    if (cnt > largest)
+      largest = cnt;
+  return largest;
+}
+
+/* Prints where the data of the inode in SECTOR, which PATH
+   names, lies on disk. */
+static void
+print_extent (disk_sector_t sector, const char *path, void *aux UNUSED)
+{
+  disk_sector_t start, parent;
+  size_t cnt;
+  bool is_dir;
+
+  if (!inode_examine (sector, &start, &cnt, &is_dir, &parent))
+    printf ("  %s: bad inode %"PRDSNu"\n", path, sector);
+  else if (cnt == 0)
+    printf ("  %s: inode %"PRDSNu", no data sectors\n", path, sector);
+  else
+    printf ("  %s: inode %"PRDSNu", %zu sectors at %"PRDSNu"-%"PRDSNu"\n",
+            path, sector, cnt, start, start + cnt - 1);
+}
+
+/* Reports how the file system disk is used: how much of it is
+   free, how the free space is broken up, and where each file's
+   data lies.  A small file's data is kept in its inode, and any
+   other file's data is always one contiguous run of sectors, so
+   a file cannot be fragmented, but free space can be, and then
+   creating or growing a file fails even though there are enough
+   free sectors in all. */
+void
+fsutil_frag (char **argv UNUSED)
+{
+  size_t histogram[32];
+  size_t free_cnt = 0, extent_cnt = 0, largest = 0;
+  disk_sector_t sector = 0;
+  size_t cnt, i;
+
+  memset (histogram, 0, sizeof histogram);
+  for (; free_map_next_free (&sector, &cnt); sector += cnt)
+    {
+      size_t bucket = 0;
+
+      while ((cnt >> (bucket + 1)) != 0)
+        bucket++;
+      histogram[bucket]++;
+      free_cnt += cnt;
+      extent_cnt++;
+      if (cnt > largest)
+        largest = cnt;
+    }
+
+  printf ("Disk usage of hd0:1:\n");
+  printf ("  %"PRDSNu" sectors, %zu free in %zu extents, "
+          "largest free extent %zu sectors\n",
+          disk_size (filesys_disk), free_cnt, extent_cnt, largest);
+  printf ("Free extents by size:\n");
+  for (i = 0; i < sizeof histogram / sizeof *histogram; i++)
+    if (histogram[i] > 0)
+      printf ("  %zu-%zu sectors: %zu\n",
+              (size_t) 1 << i, ((size_t) 2 << i) - 1, histogram[i]);
+  printf ("Files, each stored in one extent:\n");
+  walk (print_extent, NULL);
+  printf ("End of report.\n");
+}
+
+/* A file to be moved by the defragmenter. */
+struct defrag_file
+  {
+    disk_sector_t sector;       /* Sector of inode. */
+    disk_sector_t start;        /* First data sector. */
+    size_t cnt;                 /* Number of data sectors. */
+  };
+
+/* Files to be moved by the defragmenter. */
+struct defrag_list
+  {
+    struct defrag_file *files;
+    size_t cnt, max;
+  };
+
+/* Adds the inode in SECTOR to the defrag_list AUX, if it has any
+   data. */
+static void
+add_defrag_file (disk_sector_t sector, const char *path, void *aux)
+{
+  struct defrag_list *list = aux;
+  struct defrag_file *f;
+  disk_sector_t parent;
+  bool is_dir;
+
+  if (list->cnt == list->max)
+    {
+      list->max = list->max * 2 + 16;
+      list->files = realloc (list->files, list->max * sizeof *list->files);
+      if (list->files == NULL)
+        PANIC ("defrag: out of memory");
+    }
+  f = &list->files[list->cnt];
+  if (!inode_examine (sector, &f->start, &f->cnt, &is_dir, &parent))
+    printf ("defrag: %s: bad inode %"PRDSNu", skipping\n", path, sector);
+  else if (f->cnt > 0)
+    {
+      f->sector = sector;
+      list->cnt++;
+    }
+}
+
+/* Orders defrag_file A before defrag_file B by data sector. */
+static int
+compare_starts (const void *a_, const void *b_)
+{
+  const struct defrag_file *a = a_;
+  const struct defrag_file *b = b_;
+
+  return a->start < b->start ? -1 : a->start > b->start;
+}
+
+/* Returns the first sector of the first free run that lies
+   wholly before sector LIMIT and is at least CNT sectors long,
+   or LIMIT if there is none. */
+static disk_sector_t
+find_lower_run (disk_sector_t limit, size_t cnt)
+{
+  disk_sector_t sector = 0;
+  size_t run;
+
+  for (; free_map_next_free (&sector, &run) && sector < limit; sector += run)
+    if (run >= cnt && sector + cnt <= limit)
+      return sector;
+  return limit;
+}
+
+/* Compacts the file system, by moving each file's data into the
+   first free run of sectors before it that is big enough, so
+   that free space collects into large runs at the end of the
+   disk.  Repeats until no file can move.  Each move is committed
+   to the journal before the next one, so that a move never
+   overwrites sectors that another file still owns on disk. */
+void
+fsutil_defrag (char **argv UNUSED)
+{
+  struct defrag_list list;
+  size_t moved_cnt = 0, moved_sectors = 0;
+  size_t largest_before = largest_free ();
+  bool moved;
+
+  printf ("Defragmenting file system...\n");
+  list.files = NULL;
+  list.cnt = list.max = 0;
+  walk (add_defrag_file, &list);
+
+  do
+    {
+      size_t i;
+
+      moved = false;
+      qsort (list.files, list.cnt, sizeof *list.files, compare_starts);
+      for (i = 0; i < list.cnt; i++)
+        {
+          struct defrag_file *f = &list.files[i];
+          disk_sector_t start = find_lower_run (f->start, f->cnt);
+          struct inode *inode;
+
+          if (start == f->start)
+            continue;
+          inode = inode_open (f->sector);
+          if (inode == NULL || !inode_relocate (inode, start))
+            {
+              printf ("defrag: can't move inode %"PRDSNu"\n", f->sector);
+              inode_close (inode);
+              continue;
+            }
+          inode_close (inode);
+          journal_flush ();
+
+          f->start = start;
+          moved_cnt++;
+          moved_sectors += f->cnt;
+          moved = true;
+        }
+    }
+  while (moved);
+  free (list.files);
+
+  printf ("Moved %zu files, %zu sectors.  Largest free extent grew "
+          "from %zu to %zu sectors.\n",
+          moved_cnt, moved_sectors, largest_before, largest_free ());
 }
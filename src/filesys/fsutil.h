@@ -6,5 +6,9 @@ void fsutil_cat (char **argv);
 void fsutil_rm (char **argv);
 void fsutil_put (char **argv);
 void fsutil_get (char **argv);
+void fsutil_fsck (char **argv);
+void fsutil_fsck_repair (char **argv);
+void fsutil_frag (char **argv);
+void fsutil_defrag (char **argv);
 
 #endif /* filesys/fsutil.h */
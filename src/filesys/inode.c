@@ -5,20 +5,45 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#include "userprog/rlimit.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Largest file whose data can be kept in its inode. */
+#define INLINE_MAX 484
+
 /* On-disk inode.
-   Must be exactly DISK_SECTOR_SIZE bytes long. */
+   Must be exactly DISK_SECTOR_SIZE bytes long.
+
+   Data sectors are not zeroed when they are allocated.  Instead,
+   only the first VALID_LENGTH bytes of data have ever been
+   written, and the rest reads as zeros without touching the
+   disk.  The sector that holds byte VALID_LENGTH is zero-filled
+   past it when it is written, so that every sector before
+   VALID_LENGTH can be read whole.
+
+   An ordinary file of at most INLINE_MAX bytes has no data
+   sectors at all.  Its data is kept in INLINE_DATA instead, so
+   it is read along with the inode, and START and VALID_LENGTH
+   are unused.  It moves to a data sector when it grows past
+   INLINE_MAX. */
 struct inode_disk
   {
     disk_sector_t start;                /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    uint32_t is_dir;                    /* 1 for a directory, 0 for a file. */
+    disk_sector_t parent;               /* Directory containing a directory. */
+    off_t valid_length;                 /* Bytes of data ever written. */
+    uint32_t is_inline;                 /* 1 if data is in INLINE_DATA. */
+    uint8_t inline_data[INLINE_MAX];    /* Data of a small file. */
   };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -29,6 +54,14 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 }
 
+/* Returns the number of data sectors allocated to the file that
+   DISK_INODE describes. */
+static size_t
+data_sectors (const struct inode_disk *disk_inode)
+{
+  return disk_inode->is_inline ? 0 : bytes_to_sectors (disk_inode->length);
+}
+
 /* In-memory inode. */
 struct inode
   {
@@ -37,6 +70,8 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned write_cnt;                 /* Number of writes since opened. */
+    bool dirty;                         /* DATA differs from disk copy? */
     struct inode_disk data;             /* Inode content. */
 
     struct semaphore write_sema;       /* lock for reading/writing */
@@ -59,6 +94,61 @@ byte_to_sector (const struct inode *inode, off_t pos)
     return -1;
 }
 
+/* Returns true if INODE's data is file system metadata, that is,
+   if INODE is a directory or the free map.  Metadata goes
+   through the journal; ordinary file data does not. */
+static bool
+is_metadata (const struct inode *inode)
+{
+  return inode->data.is_dir || inode->sector == FREE_MAP_SECTOR;
+}
+
+/* Reads data SECTOR of INODE into BUFFER. */
+static void
+read_sector (const struct inode *inode, disk_sector_t sector, void *buffer)
+{
+  if (is_metadata (inode))
+    journal_read (sector, buffer);
+  else
+    disk_read (filesys_disk, sector, buffer);
+}
+
+/* Writes BUFFER to data SECTOR of INODE. */
+static void
+write_sector (const struct inode *inode, disk_sector_t sector,
+              const void *buffer)
+{
+  if (is_metadata (inode))
+    journal_write (sector, buffer);
+  else
+    disk_write (filesys_disk, sector, buffer);
+}
+
+/* Returns the number of whole sectors, starting with the one at
+   sector-aligned OFFSET in INODE, that a transfer of SIZE bytes
+   can move with a single disk command, at least 1.  Metadata is
+   always moved a sector at a time, through the journal.  If
+   READING, the run stops at the sector that holds the valid
+   length, since the sectors past it have never been written. */
+static size_t
+run_length (const struct inode *inode, off_t offset, off_t size,
+            bool reading)
+{
+  off_t bytes = inode->data.length - offset;
+  size_t cnt;
+
+  ASSERT (offset % DISK_SECTOR_SIZE == 0);
+
+  if (is_metadata (inode))
+    return 1;
+  if (size < bytes)
+    bytes = size;
+  cnt = bytes / DISK_SECTOR_SIZE;
+  if (reading && cnt > bytes_to_sectors (inode->data.valid_length - offset))
+    cnt = bytes_to_sectors (inode->data.valid_length - offset);
+  return cnt > 1 ? cnt : 1;
+}
+
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
@@ -72,11 +162,15 @@ inode_init (void)
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   disk.
+   disk.  The inode is for a directory if IS_DIR is true,
+   otherwise for an ordinary file.  The data reads as zeros, but
+   is not written until it is first written to, so this takes
+   only one disk write however large LENGTH is.  An ordinary file
+   of at most INLINE_MAX bytes gets no data sectors at all.
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool
-inode_create (disk_sector_t sector, off_t length)
+inode_create (disk_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
   bool success = false;
@@ -93,17 +187,15 @@ inode_create (disk_sector_t sector, off_t length)
       size_t sectors = bytes_to_sectors (length);
       disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
+      disk_inode->is_dir = is_dir;
+      if (!is_dir && sector != FREE_MAP_SECTOR && length <= INLINE_MAX)
+        {
+          disk_inode->is_inline = 1;
+          sectors = 0;
+        }
       if (free_map_allocate (sectors, &disk_inode->start))
         {
-          disk_write (filesys_disk, sector, disk_inode);
-          if (sectors > 0)
-            {
-              static char zeros[DISK_SECTOR_SIZE];
-              size_t i;
-
-              for (i = 0; i < sectors; i++)
-                disk_write (filesys_disk, disk_inode->start + i, zeros);
-            }
+          journal_write (sector, disk_inode);
           success = true;
         }
       free (disk_inode);
@@ -151,8 +243,10 @@ inode_open (disk_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->write_cnt = 0;
+  inode->dirty = false;
   inode->removed = false;
-  disk_read (filesys_disk, inode->sector, &inode->data);
+  journal_read (inode->sector, &inode->data);
 
   lock_release(&inode->oc_lock);
   return inode;
@@ -197,13 +291,17 @@ inode_close (struct inode *inode)
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
 
-      /* Deallocate blocks if removed. */
+      /* Deallocate blocks if removed, otherwise write back
+         whatever changed in the inode. */
+      journal_begin ();
       if (inode->removed)
         {
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length));
+          free_map_release (inode->data.start, data_sectors (&inode->data));
         }
+      else if (inode->dirty)
+        journal_write (inode->sector, &inode->data);
+      journal_end ();
 
       lock_release(&inode->open_cnt_lock);
       lock_release(&inode->oc_lock);
@@ -220,6 +318,215 @@ inode_remove (struct inode *inode)
 {
   ASSERT (inode != NULL);
   inode->removed = true;
+#ifdef USERPROG
+  process_forget_exec (inode);
+#endif
+}
+
+/* Copies the valid sectors of INODE's data to the run of sectors
+   starting at START, which must already be allocated, and makes
+   that run INODE's data, releasing the OLD_CNT sectors that it
+   used to occupy.  Returns true if successful, false if memory
+   allocation fails.
+
+   The copy is written directly, even for metadata, rather than
+   through the journal.  Nothing on disk refers to the new run
+   until INODE is written back, which the caller does in the same
+   transaction that releases the old run, and the old run stays
+   intact until that transaction commits.  So moving even a large
+   directory adds only a few sectors to the transaction.
+
+   The caller must have exclusive write access to INODE and must
+   also keep readers out, or one could compute a sector in the
+   old run just as it is released and reused by another file.
+   Holding dwc_lock while INODE's deny_write_cnt is 0 does both:
+   readers raise deny_write_cnt, under dwc_lock, for as long as
+   they read. */
+static bool
+move_data (struct inode *inode, disk_sector_t start, size_t old_cnt)
+{
+  size_t valid_sectors = bytes_to_sectors (inode->data.valid_length);
+  uint8_t *bounce;
+  size_t i;
+
+  bounce = malloc (DISK_SECTOR_SIZE);
+  if (bounce == NULL)
+    return false;
+  for (i = 0; i < valid_sectors; i++)
+    {
+      read_sector (inode, inode->data.start + i, bounce);
+      disk_write (filesys_disk, start + i, bounce);
+    }
+  free (bounce);
+  if (old_cnt > 0)
+    free_map_release (inode->data.start, old_cnt);
+  inode->data.start = start;
+  return true;
+}
+
+/* Moves the data of INODE, which must be inline, out of the
+   inode and into a newly allocated data sector, and writes INODE
+   back to disk.  Returns true if successful, false if no sector
+   is free or memory allocation fails.  The caller must have
+   exclusive write access to INODE. */
+static bool
+move_inline (struct inode *inode)
+{
+  size_t sectors = bytes_to_sectors (inode->data.length);
+  disk_sector_t start = 0;
+  uint8_t *bounce;
+
+  ASSERT (inode->data.is_inline);
+
+  bounce = calloc (1, DISK_SECTOR_SIZE);
+  if (bounce == NULL)
+    return false;
+  if (!free_map_allocate (sectors, &start))
+    {
+      free (bounce);
+      return false;
+    }
+  if (sectors > 0)
+    {
+      memcpy (bounce, inode->data.inline_data, inode->data.length);
+      write_sector (inode, start, bounce);
+    }
+  free (bounce);
+
+  inode->data.start = start;
+  inode->data.valid_length = inode->data.length;
+  inode->data.is_inline = 0;
+  memset (inode->data.inline_data, 0, sizeof inode->data.inline_data);
+  journal_write (inode->sector, &inode->data);
+  inode->dirty = false;
+  return true;
+}
+
+/* Makes INODE at least LENGTH bytes long, and writes INODE back
+   to disk.  The new space lies past the valid length, so it
+   reads as zeros without being written.  A file's data
+   sectors are always contiguous, so if the sectors that follow
+   INODE's data are not free, the data moves to a new run of
+   sectors big enough for all of it.  An inline file stays inline
+   while it is at most INLINE_MAX bytes long.  Returns true if
+   successful, false if no such run is free.  The caller must
+   have exclusive write access to INODE. */
+static bool
+inode_extend (struct inode *inode, off_t length)
+{
+  size_t new_sectors = bytes_to_sectors (length);
+  size_t old_sectors;
+
+  if (length <= inode->data.length)
+    return true;
+  if (inode->data.is_inline && length > INLINE_MAX && !move_inline (inode))
+    return false;
+
+  old_sectors = data_sectors (&inode->data);
+  if (!inode->data.is_inline && new_sectors > old_sectors)
+    {
+      if (old_sectors == 0
+          || !free_map_extend (inode->data.start, old_sectors, new_sectors))
+        {
+          disk_sector_t start;
+
+          if (!free_map_allocate (new_sectors, &start))
+            return false;
+          if (!move_data (inode, start, old_sectors))
+            {
+              free_map_release (start, new_sectors);
+              return false;
+            }
+        }
+    }
+
+  inode->data.length = length;
+  journal_write (inode->sector, &inode->data);
+  inode->dirty = false;
+  return true;
+}
+
+/* Moves INODE's data to the run of sectors starting at START,
+   which must be big enough for it, and writes INODE back to
+   disk.  Used by the defragmenter.  Returns true if successful,
+   false if any of those sectors is in use, memory allocation
+   fails, or INODE is being read or may not be written, as for a
+   running program. */
+bool
+inode_relocate (struct inode *inode, disk_sector_t start)
+{
+  bool success;
+  size_t cnt;
+
+  lock_acquire (&inode->dwc_lock);
+  if (inode->deny_write_cnt > 0)
+    {
+      lock_release (&inode->dwc_lock);
+      return false;
+    }
+  sema_down (&inode->write_sema);
+  cnt = data_sectors (&inode->data);
+  success = inode->data.is_inline;
+  journal_begin ();
+  if (!inode->data.is_inline && free_map_allocate_at (start, cnt))
+    {
+      if (move_data (inode, start, cnt))
+        {
+          journal_write (inode->sector, &inode->data);
+          inode->dirty = false;
+          success = true;
+        }
+      else
+        free_map_release (start, cnt);
+    }
+  journal_end ();
+  sema_up (&inode->write_sema);
+  lock_release (&inode->dwc_lock);
+  return success;
+}
+
+/* Replaces all of INODE's data by the SIZE bytes in BUFFER,
+   which must be a whole number of sectors, and writes INODE
+   back to disk.  The new data goes to a newly allocated run of
+   sectors and the old run is released, in the same way as
+   move_data(), so that this takes only a few journal sectors
+   however large SIZE is.  Returns true if successful, false if
+   no run is free or INODE is being read or may not be
+   written. */
+bool
+inode_replace (struct inode *inode, const void *buffer, off_t size)
+{
+  size_t cnt = bytes_to_sectors (size);
+  disk_sector_t start;
+  bool success = false;
+
+  ASSERT (size > 0 && size % DISK_SECTOR_SIZE == 0);
+
+  lock_acquire (&inode->dwc_lock);
+  if (inode->deny_write_cnt > 0)
+    {
+      lock_release (&inode->dwc_lock);
+      return false;
+    }
+  sema_down (&inode->write_sema);
+  journal_begin ();
+  if (!inode->data.is_inline && free_map_allocate (cnt, &start))
+    {
+      disk_write_multiple (filesys_disk, start, cnt, buffer);
+      if (data_sectors (&inode->data) > 0)
+        free_map_release (inode->data.start, data_sectors (&inode->data));
+      inode->data.start = start;
+      inode->data.length = size;
+      inode->data.valid_length = size;
+      journal_write (inode->sector, &inode->data);
+      inode->dirty = false;
+      inode->write_cnt++;
+      success = true;
+    }
+  journal_end ();
+  sema_up (&inode->write_sema);
+  lock_release (&inode->dwc_lock);
+  return success;
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -237,6 +544,19 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
+  if (inode->data.is_inline)
+    {
+      /* The data came along with the inode. */
+      if (offset < inode->data.length)
+        {
+          bytes_read = inode->data.length - offset;
+          if (size < bytes_read)
+            bytes_read = size;
+          memcpy (buffer, inode->data.inline_data + offset, bytes_read);
+        }
+      goto done;
+    }
+
   while (size > 0)
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -253,10 +573,38 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
+      /* Number of whole sectors to read at once. */
+      size_t sector_cnt = 1;
+
+      if (offset >= inode->data.valid_length)
+        {
+          /* Never written, so all zeros. */
+          memset (buffer + bytes_read, 0, chunk_size);
+          goto advance;
+        }
+      if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
+        sector_cnt = run_length (inode, offset, size, true);
+#ifdef USERPROG
+      /* Metadata is read and written on behalf of the whole file
+         system, so it is never charged or refused. */
+      if (!is_metadata (inode) && !res_charge (RES_READS, sector_cnt))
+        {
+          /* Use up whatever is left a sector at a time. */
+          sector_cnt = 1;
+          if (!res_charge (RES_READS, 1))
+            break;
+        }
+#endif
+
       if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
         {
-          /* Read full sector directly into caller's buffer. */
-          disk_read (filesys_disk, sector_idx, buffer + bytes_read);
+          /* Read full sectors directly into caller's buffer. */
+          chunk_size = sector_cnt * DISK_SECTOR_SIZE;
+          if (sector_cnt > 1)
+            disk_read_multiple (filesys_disk, sector_idx, sector_cnt,
+                                buffer + bytes_read);
+          else
+            read_sector (inode, sector_idx, buffer + bytes_read);
         }
       else
         {
@@ -268,15 +616,17 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
               if (bounce == NULL)
                 break;
             }
-          disk_read (filesys_disk, sector_idx, bounce);
+          read_sector (inode, sector_idx, bounce);
           memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
 
-      /* Advance. */
+    advance:
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+
+ done:
   free (bounce);
 
   /* prevents simultaneous change of deny_write_cnt */
@@ -287,11 +637,26 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   return bytes_read;
 }
 
+/* Makes the data of INODE up to OFFSET valid, by zeroing the
+   sectors between the valid length and OFFSET that have never
+   been written.  The caller must have exclusive write access to
+   INODE. */
+static void
+zero_fill (struct inode *inode, off_t offset)
+{
+  static char zeros[DISK_SECTOR_SIZE];
+  size_t i;
+
+  for (i = bytes_to_sectors (inode->data.valid_length);
+       i < (size_t) offset / DISK_SECTOR_SIZE; i++)
+    write_sector (inode, inode->data.start + i, zeros);
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if an error occurs.  A write past end of file
+   extends the inode, or writes nothing if it cannot be
+   extended. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset)
@@ -299,6 +664,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
+  size_t valid_sectors;
 
   lock_acquire(&inode->dwc_lock);          //prevents denying while writing
   if (inode->deny_write_cnt) {
@@ -307,6 +673,29 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   }
 
   sema_down(&inode->write_sema);           //prevents simultaneous writing
+
+  /* Growing INODE, writing inline data, and writing back a
+     metadata inode's valid length all change the inode, and must
+     be committed together. */
+  journal_begin ();
+  if (size > 0 && !inode_extend (inode, offset + size))
+    size = 0;
+  if (size > 0 && inode->data.is_inline)
+    {
+      /* Write into the inode itself. */
+#ifdef USERPROG
+      if (!res_charge (RES_WRITES, 1))
+        goto done;
+#endif
+      memcpy (inode->data.inline_data + offset, buffer, size);
+      journal_write (inode->sector, &inode->data);
+      inode->dirty = false;
+      bytes_written = size;
+      goto done;
+    }
+  if (size > 0 && offset > inode->data.valid_length)
+    zero_fill (inode, offset);
+  valid_sectors = bytes_to_sectors (inode->data.valid_length);
   while (size > 0)
     {
       /* Sector to write, starting byte offset within sector. */
@@ -320,13 +709,34 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
       /* Number of bytes to actually write into this sector. */
       int chunk_size = size < min_left ? size : min_left;
+
+      /* Number of whole sectors to write at once. */
+      size_t sector_cnt = 1;
+
       if (chunk_size <= 0)
         break;
+      if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
+        sector_cnt = run_length (inode, offset, size, false);
+#ifdef USERPROG
+      /* As for reads, metadata is never charged. */
+      if (!is_metadata (inode) && !res_charge (RES_WRITES, sector_cnt))
+        {
+          /* Use up whatever is left a sector at a time. */
+          sector_cnt = 1;
+          if (!res_charge (RES_WRITES, 1))
+            break;
+        }
+#endif
 
       if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
         {
-          /* Write full sector directly to disk. */
-          disk_write (filesys_disk, sector_idx, buffer + bytes_written);
+          /* Write full sectors directly to disk. */
+          chunk_size = sector_cnt * DISK_SECTOR_SIZE;
+          if (sector_cnt > 1)
+            disk_write_multiple (filesys_disk, sector_idx, sector_cnt,
+                                 buffer + bytes_written);
+          else
+            write_sector (inode, sector_idx, buffer + bytes_written);
         }
       else
         {
@@ -340,13 +750,15 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
           /* If the sector contains data before or after the chunk
              we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left)
-            disk_read (filesys_disk, sector_idx, bounce);
+             first.  Otherwise, or if the sector has never been
+             written, we start with a sector of all zeros. */
+          if ((sector_ofs > 0 || chunk_size < sector_left)
+              && offset / DISK_SECTOR_SIZE < (off_t) valid_sectors)
+            read_sector (inode, sector_idx, bounce);
           else
             memset (bounce, 0, DISK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          disk_write (filesys_disk, sector_idx, bounce);
+          write_sector (inode, sector_idx, bounce);
         }
 
       /* Advance. */
@@ -355,6 +767,27 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       bytes_written += chunk_size;
     }
   free (bounce);
+  if (bytes_written > 0 && offset > inode->data.valid_length)
+    {
+      /* Written back when INODE is closed, except that metadata
+         is written back at once, in the same journal transaction
+         as the data that made it grow.  Otherwise a directory
+         that stays open, like the root directory, could lose new
+         entries past its valid length in a crash. */
+      inode->data.valid_length = offset;
+      if (is_metadata (inode))
+        {
+          journal_write (inode->sector, &inode->data);
+          inode->dirty = false;
+        }
+      else
+        inode->dirty = true;
+    }
+
+ done:
+  if (bytes_written > 0)
+    inode->write_cnt++;
+  journal_end ();
 
   sema_up(&inode->write_sema);               //release writing access
   lock_release(&inode->dwc_lock);
@@ -382,9 +815,88 @@ inode_allow_write (struct inode *inode)
   inode->deny_write_cnt--;
 }
 
+/* Returns the number of writes made to INODE since it was
+   opened.  Someone who keeps INODE open can compare this value
+   over time to tell whether its contents have changed. */
+unsigned
+inode_write_cnt (const struct inode *inode)
+{
+  return inode->write_cnt;
+}
+
+/* Returns true if INODE has been removed, that is, if it will be
+   deleted when it is closed by the last opener. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
+/* Returns true if INODE is a directory, false if it is an
+   ordinary file. */
+bool
+inode_is_dir (const struct inode *inode)
+{
+  return inode->data.is_dir != 0;
+}
+
+/* Returns the sector of the directory that contains INODE, which
+   must be a directory. */
+disk_sector_t
+inode_get_parent (const struct inode *inode)
+{
+  ASSERT (inode_is_dir (inode));
+  return inode->data.parent;
+}
+
+/* Records that directory INODE is contained in the directory
+   whose inode is in sector PARENT. */
+void
+inode_set_parent (struct inode *inode, disk_sector_t parent)
+{
+  ASSERT (inode_is_dir (inode));
+  inode->data.parent = parent;
+  journal_write (inode->sector, &inode->data);
+}
+
+/* Returns the number of openers of INODE. */
+int
+inode_open_cnt (const struct inode *inode)
+{
+  return inode->open_cnt;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Reads the inode in SECTOR without opening it, for the file
+   system checker.  If SECTOR holds an inode, stores the first
+   sector and number of sectors of its data, whether it is a
+   directory, and for a directory its parent, and returns true.
+   Returns false if SECTOR does not begin with the inode magic
+   number. */
+bool
+inode_examine (disk_sector_t sector, disk_sector_t *start,
+               size_t *sector_cnt, bool *is_dir, disk_sector_t *parent)
+{
+  struct inode_disk *disk_inode = malloc (sizeof *disk_inode);
+  bool success = false;
+
+  if (disk_inode == NULL)
+    return false;
+  journal_read (sector, disk_inode);
+  if (disk_inode->magic == INODE_MAGIC)
+    {
+      *start = disk_inode->start;
+      *sector_cnt = data_sectors (disk_inode);
+      *is_dir = disk_inode->is_dir != 0;
+      *parent = disk_inode->parent;
+      success = true;
+    }
+  free (disk_inode);
+  return success;
+}
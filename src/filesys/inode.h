@@ -2,22 +2,33 @@
 #define FILESYS_INODE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "filesys/off_t.h"
 #include "devices/disk.h"
 
 struct bitmap;
 
 void inode_init (void);
-bool inode_create (disk_sector_t, off_t);
+bool inode_create (disk_sector_t, off_t, bool is_dir);
 struct inode *inode_open (disk_sector_t);
 struct inode *inode_reopen (struct inode *);
 disk_sector_t inode_get_inumber (const struct inode *);
 void inode_close (struct inode *);
 void inode_remove (struct inode *);
+bool inode_is_removed (const struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
+unsigned inode_write_cnt (const struct inode *);
+bool inode_is_dir (const struct inode *);
+disk_sector_t inode_get_parent (const struct inode *);
+void inode_set_parent (struct inode *, disk_sector_t);
+int inode_open_cnt (const struct inode *);
 off_t inode_length (const struct inode *);
+bool inode_relocate (struct inode *, disk_sector_t start);
+bool inode_replace (struct inode *, const void *, off_t size);
+bool inode_examine (disk_sector_t, disk_sector_t *start, size_t *sector_cnt,
+                    bool *is_dir, disk_sector_t *parent);
 
 #endif /* filesys/inode.h */
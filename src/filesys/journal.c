@@ -0,0 +1,362 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* The journal keeps file system metadata -- inodes, directories,
+   and the free map -- consistent across crashes.
+
+   Metadata writes do not go to disk right away.  Instead, the
+   new contents of each sector are kept in memory, where later
+   writes to the same sector replace them, until enough have
+   piled up or enough time has passed.  Then all of them are
+   committed together: written to the log sectors that follow
+   the header, made durable by writing the header with the list
+   of their home sectors, copied to their home sectors, and
+   finally retired by writing the header again with a count of
+   zero.  If the system crashes before the header is written,
+   none of the batch reaches its home sectors; if it crashes
+   afterward, journal_init() copies the log to the home sectors
+   again at the next boot.  Either way, every operation in the
+   batch takes effect entirely or not at all.
+
+   Operations that make several metadata changes, like creating
+   a file, bracket them with journal_begin() and journal_end(),
+   and a batch is committed only when no operation is in
+   progress.  An operation that by itself changed more than
+   JOURNAL_MAX sectors would force a commit in its middle, so
+   none does: the free map is written back only in the sectors
+   that change, and a directory that grows, or data that moves,
+   is written to newly allocated sectors outside the journal, so
+   that only the inode that points to them goes through it. */
+
+/* Identifies a journal header. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* Commit once this many sectors are waiting... */
+#define JOURNAL_BATCH (JOURNAL_MAX / 2)
+
+/* ...or once the oldest of them has waited this many timer
+   ticks. */
+#define JOURNAL_INTERVAL TIMER_FREQ
+
+/* On-disk journal header.
+   Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    unsigned magic;                     /* Magic number. */
+    uint32_t cnt;                       /* Committed sectors in log. */
+    disk_sector_t sectors[JOURNAL_MAX]; /* Home of each log sector. */
+  };
+
+/* A metadata sector waiting to be committed. */
+struct journal_block
+  {
+    struct hash_elem elem;              /* Element in blocks. */
+    struct list_elem free_elem;         /* Element in free_blocks. */
+    disk_sector_t sector;               /* Home sector. */
+    uint8_t data[DISK_SECTOR_SIZE];     /* New contents. */
+  };
+
+/* No more than JOURNAL_MAX sectors ever wait at once, so they
+   come from a fixed pool, and a write never fails for lack of
+   memory. */
+static struct journal_block pool[JOURNAL_MAX];
+static struct list free_blocks;
+
+/* Sectors waiting to be committed, the number of operations in
+   progress, the time the oldest waiting sector was written, and
+   the number of commits finished so far.  Protected by
+   journal_lock, as is free_blocks. */
+static struct hash blocks;
+static int active_cnt;
+static int64_t batch_start;
+static unsigned commit_cnt;
+static struct lock journal_lock;
+
+static hash_hash_func block_hash;
+static hash_less_func block_less;
+static hash_action_func block_free;
+static struct journal_block *find_block (disk_sector_t);
+static void commit (void);
+static void replay (void);
+static thread_func flusher;
+
+/* Initializes the journal.  If FORMAT is true, writes an empty
+   journal; otherwise, finishes any commit that a crash
+   interrupted.  Must be called before any other metadata is
+   read or written. */
+void
+journal_init (bool format)
+{
+  size_t i;
+
+  ASSERT (sizeof (struct journal_header) == DISK_SECTOR_SIZE);
+
+  hash_init (&blocks, block_hash, block_less, NULL);
+  list_init (&free_blocks);
+  for (i = 0; i < JOURNAL_MAX; i++)
+    list_push_back (&free_blocks, &pool[i].free_elem);
+  lock_init (&journal_lock);
+
+  if (format)
+    {
+      static struct journal_header h;
+      h.magic = JOURNAL_MAGIC;
+      disk_write (filesys_disk, JOURNAL_SECTOR, &h);
+    }
+  else
+    replay ();
+
+  thread_create ("journal", PRI_DEFAULT, flusher, NULL);
+}
+
+/* Commits everything that is waiting. */
+void
+journal_done (void)
+{
+  journal_flush ();
+}
+
+/* Begins an operation whose metadata changes must reach the disk
+   together.  Operations may nest. */
+void
+journal_begin (void)
+{
+  lock_acquire (&journal_lock);
+  active_cnt++;
+  lock_release (&journal_lock);
+}
+
+/* Ends an operation begun with journal_begin(), and commits the
+   waiting sectors if no other operation is in progress and
+   there are many of them or they have waited long enough. */
+void
+journal_end (void)
+{
+  lock_acquire (&journal_lock);
+  ASSERT (active_cnt > 0);
+  if (--active_cnt == 0 && !hash_empty (&blocks)
+      && (hash_size (&blocks) >= JOURNAL_BATCH
+          || timer_elapsed (batch_start) >= JOURNAL_INTERVAL))
+    commit ();
+  lock_release (&journal_lock);
+}
+
+/* Reads metadata SECTOR into BUFFER, which must have room for
+   DISK_SECTOR_SIZE bytes, as it was last written with
+   journal_write(). */
+void
+journal_read (disk_sector_t sector, void *buffer)
+{
+  struct journal_block *b;
+
+  lock_acquire (&journal_lock);
+  b = find_block (sector);
+  if (b != NULL)
+    memcpy (buffer, b->data, DISK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+
+  if (b == NULL)
+    disk_read (filesys_disk, sector, buffer);
+}
+
+/* Writes BUFFER, which must contain DISK_SECTOR_SIZE bytes, to
+   metadata SECTOR at the next commit. */
+void
+journal_write (disk_sector_t sector, const void *buffer)
+{
+  struct journal_block *b;
+
+  lock_acquire (&journal_lock);
+  b = find_block (sector);
+  if (b == NULL)
+    {
+      if (hash_size (&blocks) >= JOURNAL_MAX)
+        commit ();
+      b = list_entry (list_pop_front (&free_blocks),
+                      struct journal_block, free_elem);
+      if (hash_empty (&blocks))
+        batch_start = timer_ticks ();
+      b->sector = sector;
+      hash_insert (&blocks, &b->elem);
+    }
+  memcpy (b->data, buffer, DISK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+}
+
+/* Forgets any waiting writes to the CNT sectors starting at
+   SECTOR, which are being freed.  Otherwise, they could land on
+   top of data written to those sectors after they are reused
+   for an ordinary file, which bypasses the journal. */
+void
+journal_revoke (disk_sector_t sector, size_t cnt)
+{
+  size_t i;
+
+  lock_acquire (&journal_lock);
+  for (i = 0; i < cnt && !hash_empty (&blocks); i++)
+    {
+      struct journal_block *b = find_block (sector + i);
+      if (b != NULL)
+        {
+          hash_delete (&blocks, &b->elem);
+          block_free (&b->elem, NULL);
+        }
+    }
+  lock_release (&journal_lock);
+}
+
+/* Commits the waiting sectors, even if an operation is in
+   progress. */
+void
+journal_flush (void)
+{
+  lock_acquire (&journal_lock);
+  commit ();
+  lock_release (&journal_lock);
+}
+
+/* Returns the number of commits that have finished.  Everything
+   written with journal_write() before a call that returns N has
+   reached its home sector once a later call returns something
+   other than N. */
+unsigned
+journal_commit_cnt (void)
+{
+  unsigned cnt;
+
+  lock_acquire (&journal_lock);
+  cnt = commit_cnt;
+  lock_release (&journal_lock);
+  return cnt;
+}
+
+/* Writes the waiting sectors to the log, then to their home
+   sectors, and forgets them.  journal_lock must be held. */
+static void
+commit (void)
+{
+  static struct journal_header h;
+  struct hash_iterator i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+
+  if (hash_empty (&blocks))
+    return;
+
+  /* Write the log, then commit it. */
+  h.magic = JOURNAL_MAGIC;
+  h.cnt = 0;
+  hash_first (&i, &blocks);
+  while (hash_next (&i))
+    {
+      struct journal_block *b = hash_entry (hash_cur (&i),
+                                            struct journal_block, elem);
+      disk_write (filesys_disk, JOURNAL_SECTOR + 1 + h.cnt, b->data);
+      h.sectors[h.cnt++] = b->sector;
+    }
+  disk_write (filesys_disk, JOURNAL_SECTOR, &h);
+
+  /* Checkpoint: write each sector to its home, then retire the
+     log. */
+  hash_first (&i, &blocks);
+  while (hash_next (&i))
+    {
+      struct journal_block *b = hash_entry (hash_cur (&i),
+                                            struct journal_block, elem);
+      disk_write (filesys_disk, b->sector, b->data);
+    }
+  h.cnt = 0;
+  disk_write (filesys_disk, JOURNAL_SECTOR, &h);
+
+  hash_clear (&blocks, block_free);
+  commit_cnt++;
+}
+
+/* Copies a committed log that was not retired, because the
+   system crashed, to its home sectors. */
+static void
+replay (void)
+{
+  static struct journal_header h;
+  static uint8_t buffer[DISK_SECTOR_SIZE];
+  uint32_t i;
+
+  disk_read (filesys_disk, JOURNAL_SECTOR, &h);
+  if (h.magic != JOURNAL_MAGIC || h.cnt > JOURNAL_MAX)
+    PANIC ("journal corrupted--reformat with -f");
+  if (h.cnt == 0)
+    return;
+
+  printf ("Replaying %"PRIu32" journaled sectors...", h.cnt);
+  for (i = 0; i < h.cnt; i++)
+    {
+      disk_read (filesys_disk, JOURNAL_SECTOR + 1 + i, buffer);
+      disk_write (filesys_disk, h.sectors[i], buffer);
+    }
+  h.cnt = 0;
+  disk_write (filesys_disk, JOURNAL_SECTOR, &h);
+  printf ("done.\n");
+}
+
+/* Commits waiting sectors that have waited long enough even if
+   no operation ends to notice, as long as none is in
+   progress. */
+static void
+flusher (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (JOURNAL_INTERVAL);
+      lock_acquire (&journal_lock);
+      if (active_cnt == 0)
+        commit ();
+      lock_release (&journal_lock);
+    }
+}
+
+/* Returns the waiting block for SECTOR, or a null pointer if
+   there is none.  journal_lock must be held. */
+static struct journal_block *
+find_block (disk_sector_t sector)
+{
+  struct journal_block key;
+  struct hash_elem *e;
+
+  key.sector = sector;
+  e = hash_find (&blocks, &key.elem);
+  return e != NULL ? hash_entry (e, struct journal_block, elem) : NULL;
+}
+
+/* Returns a hash value for journal block E. */
+static unsigned
+block_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct journal_block, elem)->sector);
+}
+
+/* Returns true if journal block A precedes journal block B. */
+static bool
+block_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct journal_block, elem)->sector
+          < hash_entry (b, struct journal_block, elem)->sector);
+}
+
+/* Returns journal block E to the pool.  journal_lock must be
+   held. */
+static void
+block_free (struct hash_elem *e, void *aux UNUSED)
+{
+  struct journal_block *b = hash_entry (e, struct journal_block, elem);
+  list_push_front (&free_blocks, &b->free_elem);
+}
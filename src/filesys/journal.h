@@ -0,0 +1,27 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/disk.h"
+
+/* Maximum number of sectors in one commit. */
+#define JOURNAL_MAX 126
+
+/* Number of sectors the journal occupies, starting at
+   JOURNAL_SECTOR: a header followed by JOURNAL_MAX log
+   sectors. */
+#define JOURNAL_SECTORS (JOURNAL_MAX + 1)
+
+void journal_init (bool format);
+void journal_done (void);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_read (disk_sector_t, void *);
+void journal_write (disk_sector_t, const void *);
+void journal_revoke (disk_sector_t, size_t cnt);
+void journal_flush (void);
+unsigned journal_commit_cnt (void);
+
+#endif /* filesys/journal.h */
@@ -289,6 +289,32 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Finds and returns the index of the first bit at or after
+   START that is set to VALUE.  Skips whole elements that cannot
+   contain such a bit, so this takes one step per ELEM_BITS bits
+   rather than one per bit.
+   If there is no such bit, returns BITMAP_ERROR. */
+static size_t
+scan_one (const struct bitmap *b, size_t start, bool value)
+{
+  size_t idx;
+
+  for (idx = elem_idx (start); idx < elem_cnt (b->bit_cnt); idx++)
+    {
+      /* Turn the bits we are looking for into 1s and drop those
+         before START. */
+      elem_type bits = value ? b->bits[idx] : ~b->bits[idx];
+      if (idx == elem_idx (start))
+        bits &= ~(bit_mask (start) - 1);
+      if (bits != 0)
+        {
+          size_t bit_idx = idx * ELEM_BITS + __builtin_ctzl (bits);
+          return bit_idx < b->bit_cnt ? bit_idx : BITMAP_ERROR;
+        }
+    }
+  return BITMAP_ERROR;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -299,6 +325,8 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
+  if (cnt == 1)
+    return scan_one (b, start, value);
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
@@ -359,6 +387,27 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the part of B that holds the CNT bits starting at START
+   to FILE, which must already hold the rest of B, as written by
+   bitmap_write().  Writes whole elements, so a small change
+   touches only one or two sectors of FILE.  Return true if
+   successful, false otherwise. */
+bool
+bitmap_write_part (const struct bitmap *b, struct file *file,
+                   size_t start, size_t cnt)
+{
+  off_t ofs, size;
+
+  ASSERT (start <= b->bit_cnt);
+  ASSERT (cnt <= b->bit_cnt - start);
+  if (cnt == 0)
+    return true;
+  ofs = elem_idx (start) * sizeof (elem_type);
+  size = (elem_idx (start + cnt - 1) + 1) * sizeof (elem_type) - ofs;
+  return file_write_at (file, (const uint8_t *) b->bits + ofs, size, ofs)
+          == size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -28,7 +28,24 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write several buffers to a file. */
+    SYS_PREAD,                  /* Read from a file at a given position. */
+    SYS_PWRITE,                 /* Write to a file at a given position. */
+    SYS_SYSRING_SETUP,          /* Register a submission ring. */
+    SYS_SYSRING_ENTER,          /* Consume queued ring submissions. */
+    SYS_FORK,                   /* Duplicate the current process. */
+    SYS_EXEC_ASYNC,             /* Start another process, don't wait. */
+    SYS_EXEC_STATUS,            /* Wait for a process to finish loading. */
+    SYS_WAIT_ANY,               /* Wait for any child process to die. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_SHM_ATTACH,             /* Attach a shared memory region. */
+    SYS_SHM_DETACH,             /* Detach a shared memory region. */
+    SYS_FUTEX_WAIT,             /* Sleep until woken if an int is unchanged. */
+    SYS_FUTEX_WAKE              /* Wake threads sleeping on an int. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,62 @@
+#ifndef __LIB_SYSRING_H
+#define __LIB_SYSRING_H
+
+/* System call submission ring.
+
+   A process may register one `struct sysring' that it shares
+   with the kernel.  The process queues operations by filling in
+   sq[sq_tail % SYSRING_ENTRIES] and then incrementing sq_tail.
+   The kernel consumes them in order the next time the process
+   makes any system call, or explicitly on sysring_enter(), and
+   posts one completion per operation to cq[cq_tail %
+   SYSRING_ENTRIES], incrementing cq_tail.  The process consumes
+   completions by incrementing cq_head.
+
+   The kernel only writes sq_head and the completion queue, and
+   the process only writes sq_tail, cq_head and the submission
+   queue, so no locking is needed.  The kernel stops consuming
+   submissions while the completion queue is full.
+
+   The ring must lie within a single page of writable memory. */
+
+/* Number of entries in each queue. */
+#define SYSRING_ENTRIES 64
+
+/* Operations that can be submitted. */
+enum sysring_op
+  {
+    SYSRING_READ,               /* read (fd, buf, size). */
+    SYSRING_WRITE,              /* write (fd, buf, size). */
+    SYSRING_SEEK,               /* seek (fd, size). */
+    SYSRING_CREATE              /* create (buf, size). */
+  };
+
+/* Submission queue entry. */
+struct sysring_sqe
+  {
+    int op;                     /* One of enum sysring_op. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* Buffer, or file name for create. */
+    unsigned size;              /* Byte count, position or initial size. */
+    unsigned user_data;         /* Copied to the completion. */
+  };
+
+/* Completion queue entry. */
+struct sysring_cqe
+  {
+    unsigned user_data;         /* From the submission. */
+    int result;                 /* Value the system call would return. */
+  };
+
+/* A submission/completion ring. */
+struct sysring
+  {
+    unsigned sq_head;           /* Next submission the kernel consumes. */
+    unsigned sq_tail;           /* Next free submission slot. */
+    unsigned cq_head;           /* Next completion the process consumes. */
+    unsigned cq_tail;           /* Next free completion slot. */
+    struct sysring_sqe sq[SYSRING_ENTRIES];
+    struct sysring_cqe cq[SYSRING_ENTRIES];
+  };
+
+#endif /* lib/sysring.h */
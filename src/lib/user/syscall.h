@@ -2,7 +2,10 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <debug.h>
+#include <sysring.h>
+#include <uio.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -13,7 +16,7 @@ typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
 
 /* Maximum characters in a filename written by readdir(). */
-#define READDIR_MAX_LEN 14
+#define READDIR_MAX_LEN 255
 
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
@@ -45,4 +48,21 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned position);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned position);
+bool sysring_setup (struct sysring *);
+int sysring_enter (void);
+pid_t fork (void);
+pid_t exec_async (const char *file);
+int exec_status (pid_t);
+pid_t wait_any (int *status);
+bool pipe (int fds[2]);
+void *shm_attach (const char *name, size_t page_cnt);
+bool shm_detach (void *addr);
+int futex_wait (int *addr, int expected);
+int futex_wake (int *addr, int wake_cnt);
+
 #endif /* lib/user/syscall.h */
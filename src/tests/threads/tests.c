@@ -39,7 +39,8 @@ static const struct test tests[] =
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
     {"threadtest", ThreadTest},
-    {"simplethreadtest", SimpleThreadTest}
+    {"simplethreadtest", SimpleThreadTest},
+    {"thread-create-bench", test_thread_create_bench}
   };
 
 static const char *test_name;
@@ -34,6 +34,7 @@ extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
 extern test_func ThreadTest;
 extern test_func SimpleThreadTest;
+extern test_func test_thread_create_bench;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,47 @@
+/* Measures how fast threads can be created and torn down.  Each
+   thread exits as soon as it runs, so after the first few
+   iterations new threads reuse the pages of dead ones. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 2000
+
+static thread_func exit_thread;
+
+void
+test_thread_create_bench (void) 
+{
+  struct semaphore done;
+  int64_t start, elapsed;
+  int i;
+
+  sema_init (&done, 0);
+
+  start = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      tid_t tid = thread_create ("bench worker", PRI_DEFAULT,
+                                 exit_thread, &done);
+      if (tid == TID_ERROR)
+        fail ("thread_create() failed after %d threads", i);
+      sema_down (&done);
+    }
+  elapsed = timer_elapsed (start);
+
+  msg ("created %d threads in %"PRId64" ticks", THREAD_CNT, elapsed);
+  if (elapsed > 0)
+    msg ("%"PRId64" creates/s", THREAD_CNT * TIMER_FREQ / elapsed);
+}
+
+static void
+exit_thread (void *done_) 
+{
+  struct semaphore *done = done_;
+
+  sema_up (done);
+}
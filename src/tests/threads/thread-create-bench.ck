@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The timings vary from run to run, so only check that every
+# thread was created and that the test ran to completion.
+fail "missing begin message\n"
+  if !grep (/^\(thread-create-bench\) begin$/, @output);
+fail "not all threads were created\n"
+  if !grep (/^\(thread-create-bench\) created 2000 threads in \d+ ticks$/,
+	    @output);
+fail "missing end message\n"
+  if !grep (/^\(thread-create-bench\) end$/, @output);
+pass;
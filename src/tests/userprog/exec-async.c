@@ -0,0 +1,29 @@
+/* Starts a child with exec_async(), waits for it to load with
+   exec_status(), and then waits for it to exit.  Then does the
+   same for a program that does not exist, which must fail to
+   load, and asks for the status of a process that is not a
+   child.  Nothing is printed until each child has exited, so
+   that the output does not depend on scheduling. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t pid;
+  int status;
+
+  pid = exec_async ("child-simple");
+  status = exec_status (pid);
+  msg ("exec_async(\"child-simple\"): status %d, exit %d",
+       status, wait (pid));
+
+  pid = exec_async ("no-such-file");
+  status = exec_status (pid);
+  msg ("exec_async(\"no-such-file\"): status %d, exit %d",
+       status, wait (pid));
+
+  msg ("exec_status() of a non-child = %d", exec_status (pid + 1000));
+}
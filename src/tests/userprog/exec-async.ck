@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF', <<'EOF']);
+(exec-async) begin
+(child-simple) run
+(exec-async) exec_async("child-simple"): status 1, exit 81
+load: no-such-file: open failed
+(exec-async) exec_async("no-such-file"): status 0, exit -1
+(exec-async) exec_status() of a non-child = -1
+(exec-async) end
+EOF
+(exec-async) begin
+(child-simple) run
+(exec-async) exec_async("child-simple"): status 1, exit 81
+(exec-async) exec_async("no-such-file"): status 0, exit -1
+(exec-async) exec_status() of a non-child = -1
+(exec-async) end
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Forks a child, which sees the parent's memory as it was at
+   the time of the fork, and then changes it.  The changes must
+   not show up in the parent, because the two share memory only
+   until one of them writes to it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int value;
+static char page[4096];
+
+void
+test_main (void) 
+{
+  pid_t pid;
+
+  value = 1;
+  page[sizeof page - 1] = 'p';
+  pid = fork ();
+  if (pid == 0)
+    {
+      msg ("child: value = %d, page = '%c'", value, page[sizeof page - 1]);
+      value = 2;
+      page[sizeof page - 1] = 'c';
+      msg ("child: set value = %d, page = '%c'",
+           value, page[sizeof page - 1]);
+      exit (81);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork");
+  msg ("wait(fork()) = %d", wait (pid));
+  msg ("parent: value = %d, page = '%c'", value, page[sizeof page - 1]);
+}
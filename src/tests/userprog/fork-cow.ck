@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-cow) begin
+(fork-cow) child: value = 1, page = 'p'
+(fork-cow) child: set value = 2, page = 'c'
+fork-cow: exit(81)
+(fork-cow) wait(fork()) = 81
+(fork-cow) parent: value = 1, page = 'p'
+(fork-cow) end
+fork-cow: exit(0)
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Forks a child that waits on a futex in shared memory until
+   the parent changes its value and wakes it.  Also checks that
+   futex_wait() returns at once if the value has already
+   changed, and that futex_wake() with no waiters wakes no
+   one. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int *word;
+  pid_t pid;
+
+  CHECK ((word = shm_attach ("futex-wake", 1)) != NULL, "shm_attach");
+  *word = 0;
+  pid = fork ();
+  if (pid == 0)
+    {
+      while (*word == 0)
+        futex_wait (word, 0);
+      exit (*word);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork");
+  *word = 7;
+  futex_wake (word, 1);
+  msg ("wait(fork()) = %d", wait (pid));
+
+  msg ("futex_wait() with another value = %d", futex_wait (word, 0));
+  msg ("futex_wake() with no waiters = %d", futex_wake (word, 1));
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-wake) begin
+(futex-wake) shm_attach
+futex-wake: exit(7)
+(futex-wake) wait(fork()) = 7
+(futex-wake) futex_wait() with another value = 1
+(futex-wake) futex_wake() with no waiters = 0
+(futex-wake) end
+futex-wake: exit(0)
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Forks a child that writes to a pipe and exits.  The parent,
+   having closed its own write end, reads the data and then end
+   of file, since no writer is left.  Then writes to a pipe whose
+   read end is closed, which must fail. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[16];
+  int fds[2];
+  pid_t pid;
+  int n;
+
+  CHECK (pipe (fds), "pipe");
+  pid = fork ();
+  if (pid == 0)
+    {
+      close (fds[0]);
+      exit (write (fds[1], "hello", 5));
+    }
+  if (pid == PID_ERROR)
+    fail ("fork");
+  close (fds[1]);
+  msg ("wait(fork()) = %d", wait (pid));
+
+  n = read (fds[0], buf, sizeof buf);
+  if (n != 5 || memcmp (buf, "hello", 5))
+    fail ("read %d bytes, expected \"hello\"", n);
+  msg ("read \"hello\"");
+  msg ("read() at end of file = %d", read (fds[0], buf, sizeof buf));
+  close (fds[0]);
+
+  CHECK (pipe (fds), "pipe");
+  close (fds[0]);
+  msg ("write() with no reader = %d", write (fds[1], "x", 1));
+}
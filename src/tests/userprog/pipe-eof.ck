@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-eof) begin
+(pipe-eof) pipe
+pipe-eof: exit(5)
+(pipe-eof) wait(fork()) = 5
+(pipe-eof) read "hello"
+(pipe-eof) read() at end of file = 0
+(pipe-eof) pipe
+(pipe-eof) write() with no reader = -1
+(pipe-eof) end
+pipe-eof: exit(0)
+EOF
+pass;
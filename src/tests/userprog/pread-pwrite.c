@@ -0,0 +1,29 @@
+/* Overwrites the middle of a file with pwrite() and reads it
+   back with pread(), checking that neither one moves the file
+   position. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[8];
+  int handle;
+
+  CHECK (create ("positional", 0), "create \"positional\"");
+  CHECK ((handle = open ("positional")) > 1, "open \"positional\"");
+  CHECK (write (handle, "abcdefgh", 8) == 8, "write \"abcdefgh\"");
+  msg ("pwrite() = %d", pwrite (handle, "XY", 2, 2));
+  msg ("tell() after pwrite() = %u", tell (handle));
+  msg ("pread() = %d", pread (handle, buf, 4, 1));
+  if (memcmp (buf, "bXYe", 4))
+    fail ("pread() read the wrong data");
+  msg ("pread() past end of file = %d", pread (handle, buf, 4, 100));
+  seek (handle, 0);
+  msg ("read() = %d", read (handle, buf, 8));
+  if (memcmp (buf, "abXYefgh", 8))
+    fail ("read() read the wrong data");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "positional"
+(pread-pwrite) open "positional"
+(pread-pwrite) write "abcdefgh"
+(pread-pwrite) pwrite() = 2
+(pread-pwrite) tell() after pwrite() = 8
+(pread-pwrite) pread() = 4
+(pread-pwrite) pread() past end of file = 0
+(pread-pwrite) read() = 8
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
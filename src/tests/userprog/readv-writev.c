@@ -0,0 +1,28 @@
+/* Writes a file with writev() from three buffers, one of them
+   empty, and reads it back with readv() into two buffers, the
+   last of which is only partly filled. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char abc[] = "abc", defgh[] = "defgh";
+  struct iovec out[3] = {{abc, 3}, {NULL, 0}, {defgh, 5}};
+  char first[3], second[10];
+  struct iovec in[2] = {{first, sizeof first}, {second, sizeof second}};
+  int handle;
+
+  CHECK (create ("vector", 0), "create \"vector\"");
+  CHECK ((handle = open ("vector")) > 1, "open \"vector\"");
+  msg ("writev() = %d", writev (handle, out, 3));
+  seek (handle, 0);
+  msg ("readv() = %d", readv (handle, in, 2));
+  if (memcmp (first, "abc", 3) || memcmp (second, "defgh", 5))
+    fail ("readv() read the wrong data");
+  msg ("readv() at end of file = %d", readv (handle, in, 2));
+  msg ("readv() with bad fd = %d", readv (handle + 1, in, 2));
+}
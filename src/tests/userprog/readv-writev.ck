@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "vector"
+(readv-writev) open "vector"
+(readv-writev) writev() = 8
+(readv-writev) readv() = 8
+(readv-writev) readv() at end of file = 0
+(readv-writev) readv() with bad fd = -1
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
@@ -0,0 +1,23 @@
+/* Opens a file repeatedly under a soft limit of 2 open files and
+   a hard limit of 3, set on the kernel command line.  The third
+   open draws a warning, the fourth fails, and closing a file
+   makes room for another. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handles[3];
+  int i;
+
+  for (i = 0; i < 3; i++)
+    CHECK ((handles[i] = open ("sample.txt")) > 1,
+           "open \"sample.txt\" #%d", i + 1);
+  msg ("open \"sample.txt\" #4 = %d", open ("sample.txt"));
+  close (handles[0]);
+  CHECK ((handles[0] = open ("sample.txt")) > 1,
+         "open \"sample.txt\" after close");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rlimit-files) begin
+(rlimit-files) open "sample.txt" #1
+(rlimit-files) open "sample.txt" #2
+rlimit-files: over soft limit of 2 files
+(rlimit-files) open "sample.txt" #3
+(rlimit-files) open "sample.txt" #4 = -1
+(rlimit-files) open "sample.txt" after close
+(rlimit-files) end
+rlimit-files: exit(0)
+EOF
+pass;
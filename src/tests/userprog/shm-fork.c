@@ -0,0 +1,38 @@
+/* Attaches a shared memory region and forks.  A write by the
+   child to the region shows up in the parent, unlike a write to
+   ordinary memory, and so does one made through a second
+   attachment of the same region by name. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int private;
+
+void
+test_main (void) 
+{
+  int *shared, *again;
+  pid_t pid;
+
+  CHECK ((shared = shm_attach ("shm-fork", 1)) != NULL, "shm_attach");
+  *shared = 1;
+  private = 1;
+  pid = fork ();
+  if (pid == 0)
+    {
+      *shared = 2;
+      private = 2;
+      again = shm_attach ("shm-fork", 0);
+      if (again == NULL || again == shared)
+        exit (-1);
+      again[1] = 3;
+      exit (0);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork");
+  msg ("wait(fork()) = %d", wait (pid));
+  msg ("shared = %d, %d; private = %d", shared[0], shared[1], private);
+  CHECK (shm_detach (shared), "shm_detach");
+  msg ("shm_detach() again = %d", shm_detach (shared));
+}
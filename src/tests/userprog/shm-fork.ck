@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-fork) begin
+(shm-fork) shm_attach
+shm-fork: exit(0)
+(shm-fork) wait(fork()) = 0
+(shm-fork) shared = 2, 3; private = 1
+(shm-fork) shm_detach
+(shm-fork) shm_detach() again = 0
+(shm-fork) end
+shm-fork: exit(0)
+EOF
+pass;
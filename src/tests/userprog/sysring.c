@@ -0,0 +1,69 @@
+/* Queues operations in a system call submission ring and checks
+   their completions.  The operations are performed both on an
+   explicit sysring_enter() and, ahead of the call, on any other
+   system call. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Page aligned, so that the ring lies within a single page. */
+static struct sysring ring __attribute__ ((aligned (4096)));
+
+/* Queues an operation. */
+static void
+submit (int op, int fd, void *buf, unsigned size, unsigned user_data)
+{
+  struct sysring_sqe *sqe = &ring.sq[ring.sq_tail % SYSRING_ENTRIES];
+
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->size = size;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+/* Consumes the next completion and prints it. */
+static void
+complete (void)
+{
+  struct sysring_cqe *cqe = &ring.cq[ring.cq_head % SYSRING_ENTRIES];
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("no completion");
+  msg ("completion %u: %d", cqe->user_data, cqe->result);
+  ring.cq_head++;
+}
+
+void
+test_main (void) 
+{
+  char name[] = "ring";
+  char data[] = "hello";
+  char buf[sizeof data];
+  int handle;
+
+  CHECK (sysring_setup (&ring), "sysring_setup");
+  submit (SYSRING_CREATE, 0, name, 0, 1);
+  msg ("sysring_enter() = %d", sysring_enter ());
+  complete ();
+
+  CHECK ((handle = open ("ring")) > 1, "open \"ring\"");
+  submit (SYSRING_WRITE, handle, data, 5, 2);
+  submit (SYSRING_SEEK, handle, NULL, 1, 3);
+  submit (SYSRING_READ, handle, buf, 5, 4);
+  msg ("sysring_enter() = %d", sysring_enter ());
+  complete ();
+  complete ();
+  complete ();
+  buf[4] = '\0';
+  msg ("read \"%s\"", buf);
+
+  /* Performed before tell() itself. */
+  submit (SYSRING_SEEK, handle, NULL, 2, 5);
+  msg ("tell() = %u", tell (handle));
+  complete ();
+  msg ("sysring_enter() with nothing queued = %d", sysring_enter ());
+}
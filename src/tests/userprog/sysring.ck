@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sysring) begin
+(sysring) sysring_setup
+(sysring) sysring_enter() = 1
+(sysring) completion 1: 1
+(sysring) open "ring"
+(sysring) sysring_enter() = 3
+(sysring) completion 2: 5
+(sysring) completion 3: 0
+(sysring) completion 4: 4
+(sysring) read "ello"
+(sysring) tell() = 2
+(sysring) completion 5: 0
+(sysring) sysring_enter() with nothing queued = 0
+(sysring) end
+sysring: exit(0)
+EOF
+pass;
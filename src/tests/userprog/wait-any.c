@@ -0,0 +1,41 @@
+/* Forks three children that exit with different statuses, and
+   reaps them with wait_any(), in whatever order they exit.  Once
+   all of them have been reaped, wait_any() must fail. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 3
+
+void
+test_main (void) 
+{
+  pid_t pids[CHILD_CNT];
+  int seen = 0;
+  int i, j;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pids[i] = fork ();
+      if (pids[i] == 0)
+        exit (10 + i);
+      if (pids[i] == PID_ERROR)
+        fail ("fork");
+    }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      int status;
+      pid_t pid = wait_any (&status);
+
+      for (j = 0; j < CHILD_CNT; j++)
+        if (pids[j] == pid)
+          break;
+      if (j == CHILD_CNT || status != 10 + j || (seen & (1 << j)))
+        fail ("wait_any() returned pid %d with status %d", pid, status);
+      seen |= 1 << j;
+    }
+  msg ("reaped %d children", CHILD_CNT);
+  msg ("wait_any() with no children = %d", wait_any (NULL));
+}
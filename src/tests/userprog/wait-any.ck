@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(wait-any) begin
+(wait-any) reaped 3 children
+(wait-any) wait_any() with no children = -1
+(wait-any) end
+EOF
+pass;
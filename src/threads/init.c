@@ -23,7 +23,10 @@
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
+#include "userprog/rlimit.h"
+#include "userprog/shm.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
@@ -102,6 +105,9 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
+  shm_init ();
+  futex_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
@@ -247,6 +253,13 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-rlimit"))
+        {
+          if (!rlimit_parse (value))
+            PANIC ("bad resource limit `%s' (use -h for help)", value);
+        }
+      else if (!strcmp (name, "-rusage"))
+        rusage_report = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -293,6 +306,10 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"put", 2, fsutil_put},
       {"get", 2, fsutil_get},
+      {"fsck", 1, fsutil_fsck},
+      {"fsck-repair", 1, fsutil_fsck_repair},
+      {"frag", 1, fsutil_frag},
+      {"defrag", 1, fsutil_defrag},
 #endif
       {NULL, 0, NULL},
     };
@@ -339,6 +356,10 @@ usage (void)
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
           "  rm FILE            Delete FILE.\n"
+          "  fsck               Check the file system for consistency.\n"
+          "  fsck-repair        Check the file system and repair it.\n"
+          "  frag               Report disk usage and free space fragmentation.\n"
+          "  defrag             Compact files to consolidate free space.\n"
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  put FILE           Put FILE into file system from scratch disk.\n"
           "  get FILE           Get FILE from file system into scratch disk.\n"
@@ -351,6 +372,10 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -rlimit=RES=SOFT[:HARD]  Limit each process's use of RES,\n"
+          "                     one of frames, kpages, files, reads,\n"
+          "                     writes or ticks.\n"
+          "  -rusage            Print each process's usage at exit.\n"
 #endif
           );
   power_off ();
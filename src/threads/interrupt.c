@@ -9,6 +9,11 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/rlimit.h"
+#include "userprog/syscall.h"
+#endif
 
 /* Number of x86 interrupts. */
 #define INTR_CNT 256
@@ -384,6 +389,19 @@ intr_handler (struct intr_frame *frame)
 
       if (yield_on_return) 
         thread_yield (); 
+
+#ifdef USERPROG
+      /* Ticks are counted by the timer interrupt and can't be
+         refused, so a process that has run past its limit is
+         stopped here, on its way back to user mode.  This is the
+         only check: a process that runs long enough to go over is
+         sure to be interrupted in user mode again. */
+      if (frame->cs == SEL_UCSEG && res_over_limit (RES_TICKS))
+        {
+          intr_enable ();
+          exit (-1);
+        }
+#endif
     }
 }
 
@@ -15,6 +15,9 @@
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
+#ifdef FILESYS
+#include "filesys/directory.h"
+#endif
 
 /* Random value for struct thread's `magic' member.
    Used to detect stack overflow.  See the big comment at the top
@@ -34,6 +37,14 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Pages of threads that have died, kept for reuse by
+   thread_create() instead of being returned to the page
+   allocator.  Filled by schedule_tail().  Accessed only with
+   interrupts off. */
+#define THREAD_CACHE_SIZE 8
+static struct thread *thread_cache[THREAD_CACHE_SIZE];
+static size_t thread_cache_cnt;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame
   {
@@ -67,6 +78,7 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *thread_page_alloc (void);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -125,7 +137,10 @@ thread_tick (void)
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
-    user_ticks++;
+    {
+      user_ticks++;
+      t->rusage.peak[RES_TICKS] = ++t->rusage.cur[RES_TICKS];
+    }
 #endif
   else
     kernel_ticks++;
@@ -171,22 +186,21 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_alloc ();
   if (t == NULL)
     return TID_ERROR;
 
-  char *s;
-  s = palloc_get_page(0);
-  if (s == NULL)
-    return TID_ERROR;
-
-  char *token, *save_ptr;
-  strlcpy(s, name, PGSIZE);
-  token = strtok_r(s, " ", &save_ptr); //file name is argv[0];
-
-  /* Initialize thread. */
-  init_thread (t, token, priority);
+  /* Initialize thread.  The name is the first word of NAME, which
+     may be a whole command line (argv[0] is the file name). */
+  name += strspn (name, " ");
+  init_thread (t, name, priority);
+  t->name[strcspn (t->name, " ")] = '\0';
   tid = t->tid = allocate_tid ();
+#ifdef FILESYS
+  /* Start out in the creator's working directory. */
+  if (thread_current ()->cwd != NULL)
+    t->cwd = dir_reopen (thread_current ()->cwd);
+#endif
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -287,12 +301,11 @@ thread_exit (void)
   ASSERT (!intr_context ());
 
 #ifdef USERPROG
-    int fd ;
-    for (fd = 0; fd<MAX_FILES; ++fd) {
-      close(fd+OFFSET);
-    }
-
-    process_exit ();
+  process_exit ();
+#endif
+#ifdef FILESYS
+  dir_close (thread_current ()->cwd);
+  thread_current ()->cwd = NULL;
 #endif
 
   /* Just set our status to dying and schedule another process.
@@ -445,22 +458,12 @@ init_thread (struct thread *t, const char *name, int priority)
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
 
-#ifdef USERPROG
-    int i;
-    for (i = 0; i<MAX_FILES; ++i) {
-        t->files[i] = NULL;
-    }
-#endif
-
-
   memset (t, 0, sizeof *t);
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
-
-  list_init(&t->child_list);
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -532,10 +535,30 @@ schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      if (thread_cache_cnt < THREAD_CACHE_SIZE)
+        thread_cache[thread_cache_cnt++] = prev;
+      else
+        palloc_free_page (prev);
     }
 }
 
+/* Returns a page for a new thread, reusing the page of a thread
+   that has died if one is cached.  Only the struct thread at the
+   start of the page is zeroed, by init_thread(). */
+static struct thread *
+thread_page_alloc (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt > 0)
+    t = thread_cache[--thread_cache_cnt];
+  intr_set_level (old_level);
+
+  return t != NULL ? t : palloc_get_page (0);
+}
+
 /* Schedules a new process.  At entry, interrupts must be off and
    the running process's state must have been changed from
    running to some other state.  This function finds another
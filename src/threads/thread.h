@@ -2,6 +2,7 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
 #include "threads/synch.h"
@@ -9,6 +10,7 @@
 #ifdef USERPROG
   #include "filesys/file.h"
   #include "filesys/filesys.h"
+  #include "userprog/rlimit.h"
   #include "userprog/syscall.h"
 #endif
 /* States in a thread's life cycle. */
@@ -95,9 +97,15 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     #ifdef USERPROG
-    struct file *files[MAX_FILES];      /* Array containing names of files */
+    struct fd_table *fds;               /* Open files, null until first open. */
+    struct sysring *ring;               /* Submission ring, if registered. */
+    struct shm_map *shm_maps;           /* Attached shared memory regions. */
+    struct rusage rusage;               /* Resource usage. */
     #endif
-    struct list child_list;
+    struct children *children;          /* Child processes, null until the first. */
+#ifdef FILESYS
+    struct dir *cwd;                    /* Working directory, null for root. */
+#endif
     struct pc_status *parent_pcs;
 
     /* Shared between thread.c and synch.c. */
@@ -121,10 +129,12 @@ struct pc_status {
   struct lock exit_lock;            //used when checking alive count
   struct semaphore sema_wait;       //used when waiting for child to terminate
   struct semaphore sema_exec;       //used when waiting for child to execute
-  char *f_name;
   tid_t child_id;
+  struct children *owner;           //parent's children
 
-  struct list_elem elem;            //list element
+  struct hash_elem hash_elem;       //element in owner's by_tid
+  struct list_elem exited_elem;     //element in owner's exited list
+  char f_name[];                    //command line, for load
   };
 
 /* If false (default), use round-robin scheduler.
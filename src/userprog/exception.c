@@ -2,14 +2,18 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+static bool is_user_accessor (const char *eip);
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -148,6 +152,31 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+  /* A write to a copy-on-write page, by the process or by the
+     kernel on its behalf, gets a private copy of the page and is
+     then retried. */
+  if (!not_present && write && is_user_vaddr (fault_addr)
+      && thread_current ()->pagedir != NULL
+      && pagedir_copy_on_write (thread_current ()->pagedir,
+                                pg_round_down (fault_addr)))
+    return;
+
+  /* A kernel access to a user address that faults in one of the
+     user memory accessors in userprog/syscall.c, on behalf of a
+     user process, continues at the recovery address that the
+     accessor left in EAX, with EAX set to -1 so that the accessor
+     reports the failure.  The accessor's caller then releases
+     whatever it holds and kills the process.  Any other kernel
+     fault is a kernel bug, and falls through to kill(). */
+  if (!user && is_user_vaddr (fault_addr)
+      && thread_current ()->pagedir != NULL
+      && is_user_accessor ((const char *) f->eip))
+    {
+      f->eip = (void (*) (void)) f->eax;
+      f->eax = 0xffffffff;
+      return;
+    }
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
@@ -159,3 +188,11 @@ page_fault (struct intr_frame *f)
   kill (f);
 }
 
+/* Returns true if EIP is the faulting instruction of one of the
+   user memory accessors in userprog/syscall.c. */
+static bool
+is_user_accessor (const char *eip)
+{
+  return eip == user_get_insn || eip == user_put_insn
+         || eip == user_copy_insn;
+}
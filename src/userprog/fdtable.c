@@ -0,0 +1,240 @@
+#include "userprog/fdtable.h"
+#include <bitmap.h>
+#include <debug.h>
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "userprog/pipe.h"
+
+/* Number of slots in a newly created table.  The table doubles
+   in size whenever it runs out of free slots, up to FD_MAX. */
+#define FD_TABLE_INITIAL 16
+
+/* An open file descriptor. */
+struct fd_entry
+  {
+    enum fd_type type;          /* Kind of object. */
+    void *obj;                  /* The object itself. */
+  };
+
+/* A process's open files, indexed by file descriptor.
+
+   A bitmap tracks which slots are in use, so finding the lowest
+   free descriptor is a find-first-zero over the bitmap rather
+   than a scan over the slots themselves. */
+struct fd_table
+  {
+    struct fd_entry *files;     /* Open files, indexed by fd - FD_MIN. */
+    struct bitmap *used;        /* One bit per slot, true if in use. */
+    size_t size;                /* Number of slots. */
+  };
+
+static struct fd_table *create (size_t size);
+static bool grow (struct fd_table *);
+static void close_entry (struct fd_entry *);
+
+/* Creates and returns an empty file descriptor table, or a null
+   pointer if memory allocation fails. */
+struct fd_table *
+fd_table_create (void)
+{
+  return create (FD_TABLE_INITIAL);
+}
+
+/* Returns a copy of FDT in which each open descriptor refers to
+   the same object.  Files are reopened, at the same position, so
+   that the copy has handles of its own, and so are directories,
+   from their first entry; pipe ends are shared.
+   Returns a null pointer if memory allocation fails. */
+struct fd_table *
+fd_table_clone (struct fd_table *fdt)
+{
+  struct fd_table *copy;
+  size_t idx;
+
+  ASSERT (fdt != NULL);
+
+  copy = create (fdt->size);
+  if (copy == NULL)
+    return NULL;
+
+  for (idx = bitmap_scan (fdt->used, 0, 1, true); idx != BITMAP_ERROR;
+       idx = bitmap_scan (fdt->used, idx + 1, 1, true))
+    {
+      struct fd_entry *e = &fdt->files[idx];
+
+      copy->files[idx] = *e;
+      if (e->type == FD_FILE)
+        {
+          struct file *file = file_reopen (e->obj);
+          if (file == NULL)
+            {
+              fd_table_destroy (copy);
+              return NULL;
+            }
+          file_seek (file, file_tell (e->obj));
+          copy->files[idx].obj = file;
+        }
+      else if (e->type == FD_DIR)
+        {
+          copy->files[idx].obj = dir_reopen (e->obj);
+          if (copy->files[idx].obj == NULL)
+            {
+              fd_table_destroy (copy);
+              return NULL;
+            }
+        }
+      else
+        pipe_reopen (e->obj, e->type == FD_PIPE_WRITE);
+      bitmap_mark (copy->used, idx);
+    }
+  return copy;
+}
+
+/* Closes every file still open in FDT and frees FDT.
+   FDT may be a null pointer, in which case this does nothing. */
+void
+fd_table_destroy (struct fd_table *fdt)
+{
+  size_t idx;
+
+  if (fdt == NULL)
+    return;
+
+  for (idx = bitmap_scan (fdt->used, 0, 1, true); idx != BITMAP_ERROR;
+       idx = bitmap_scan (fdt->used, idx + 1, 1, true))
+    close_entry (&fdt->files[idx]);
+
+  bitmap_destroy (fdt->used);
+  free (fdt->files);
+  free (fdt);
+}
+
+/* Adds OBJ, of the given TYPE, to FDT under the lowest free file
+   descriptor and returns that descriptor.  Returns -1 if the
+   table is full or cannot grow. */
+int
+fd_table_add (struct fd_table *fdt, enum fd_type type, void *obj)
+{
+  size_t idx;
+
+  ASSERT (obj != NULL);
+
+  idx = bitmap_scan_and_flip (fdt->used, 0, 1, false);
+  if (idx == BITMAP_ERROR)
+    {
+      /* Every slot is in use, so the first new slot is free. */
+      idx = fdt->size;
+      if (!grow (fdt))
+        return -1;
+      bitmap_mark (fdt->used, idx);
+    }
+  fdt->files[idx].type = type;
+  fdt->files[idx].obj = obj;
+  return idx + FD_MIN;
+}
+
+/* Returns the entry for FD in FDT, or a null pointer if FD is
+   not open.  FDT may be a null pointer. */
+static struct fd_entry *
+lookup (struct fd_table *fdt, int fd)
+{
+  size_t idx = fd - FD_MIN;
+
+  if (fdt == NULL || fd < FD_MIN || idx >= fdt->size
+      || !bitmap_test (fdt->used, idx))
+    return NULL;
+  return &fdt->files[idx];
+}
+
+/* Returns the object open as FD in FDT, or a null pointer if FD
+   is not open or does not refer to an object of the given TYPE.
+   FDT may be a null pointer. */
+void *
+fd_table_get (struct fd_table *fdt, int fd, enum fd_type type)
+{
+  struct fd_entry *e = lookup (fdt, fd);
+
+  return e != NULL && e->type == type ? e->obj : NULL;
+}
+
+/* Closes FD in FDT and removes it from the table.  Returns true
+   if successful, false if FD is not open. */
+bool
+fd_table_close (struct fd_table *fdt, int fd)
+{
+  struct fd_entry *e = lookup (fdt, fd);
+
+  if (e == NULL)
+    return false;
+  close_entry (e);
+  bitmap_reset (fdt->used, fd - FD_MIN);
+  return true;
+}
+
+/* Closes the object that E refers to. */
+static void
+close_entry (struct fd_entry *e)
+{
+  if (e->type == FD_FILE)
+    file_close (e->obj);
+  else if (e->type == FD_DIR)
+    dir_close (e->obj);
+  else
+    pipe_close (e->obj, e->type == FD_PIPE_WRITE);
+}
+
+/* Creates and returns an empty table with SIZE slots, or a null
+   pointer if memory allocation fails. */
+static struct fd_table *
+create (size_t size)
+{
+  struct fd_table *fdt = malloc (sizeof *fdt);
+  if (fdt == NULL)
+    return NULL;
+
+  fdt->size = size;
+  fdt->files = malloc (fdt->size * sizeof *fdt->files);
+  fdt->used = bitmap_create (fdt->size);
+  if (fdt->files == NULL || fdt->used == NULL)
+    {
+      free (fdt->files);
+      bitmap_destroy (fdt->used);
+      free (fdt);
+      return NULL;
+    }
+  return fdt;
+}
+
+/* Doubles the number of slots in FDT, all of which must be in
+   use.  Returns true if successful, false if FDT is already at
+   FD_MAX descriptors or memory allocation fails. */
+static bool
+grow (struct fd_table *fdt)
+{
+  size_t new_size = fdt->size * 2;
+  struct fd_entry *files;
+  struct bitmap *used;
+
+  if (new_size > FD_MAX - FD_MIN)
+    new_size = FD_MAX - FD_MIN;
+  if (new_size <= fdt->size)
+    return false;
+
+  used = bitmap_create (new_size);
+  if (used == NULL)
+    return false;
+  files = realloc (fdt->files, new_size * sizeof *files);
+  if (files == NULL)
+    {
+      bitmap_destroy (used);
+      return false;
+    }
+
+  bitmap_set_multiple (used, 0, fdt->size, true);
+  bitmap_destroy (fdt->used);
+  fdt->used = used;
+  fdt->files = files;
+  fdt->size = new_size;
+  return true;
+}
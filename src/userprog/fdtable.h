@@ -0,0 +1,29 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+
+/* File descriptors 0 and 1 are the console, so the first
+   descriptor handed out for an open file is FD_MIN. */
+#define FD_MIN 2
+
+/* Maximum number of files a process may have open at once. */
+#define FD_MAX 4096
+
+/* Kinds of object a file descriptor can refer to. */
+enum fd_type
+  {
+    FD_FILE,                    /* struct file. */
+    FD_DIR,                     /* struct dir. */
+    FD_PIPE_READ,               /* Read end of a struct pipe. */
+    FD_PIPE_WRITE               /* Write end of a struct pipe. */
+  };
+
+struct fd_table *fd_table_create (void);
+struct fd_table *fd_table_clone (struct fd_table *);
+void fd_table_destroy (struct fd_table *);
+int fd_table_add (struct fd_table *, enum fd_type, void *obj);
+void *fd_table_get (struct fd_table *, int fd, enum fd_type);
+bool fd_table_close (struct fd_table *, int fd);
+
+#endif /* userprog/fdtable.h */
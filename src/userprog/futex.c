@@ -0,0 +1,170 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdint.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+
+/* Fast user-space locking.
+
+   A user program keeps its lock or condition in an ordinary int
+   and updates it with atomic instructions, entering the kernel
+   only to sleep until the int changes (futex_wait()) or to wake
+   sleepers after changing it (futex_wake()).
+
+   Waiters are queued by the physical address of the int rather
+   than its user address, so that processes that map the same
+   frame at different addresses, e.g. by attaching the same
+   shared memory region, find the same queue.  A queue exists
+   only while some thread is waiting on it. */
+struct futex
+  {
+    struct hash_elem elem;      /* Element in futexes. */
+    const int *key;             /* Kernel address of the int. */
+    struct semaphore sema;      /* Queue of waiters. */
+    int waiter_cnt;             /* Waiters not yet woken. */
+    int user_cnt;               /* Waiters not yet returned. */
+  };
+
+/* All futexes with waiters, protected by futex_lock. */
+static struct hash futexes;
+static struct lock futex_lock;
+
+static hash_hash_func futex_hash;
+static hash_less_func futex_less;
+static const int *futex_key (const int *uaddr);
+static struct futex *find_futex (const int *key);
+
+/* Initializes the futex queues. */
+void
+futex_init (void)
+{
+  hash_init (&futexes, futex_hash, futex_less, NULL);
+  lock_init (&futex_lock);
+}
+
+/* If the int at user address UADDR still holds EXPECTED, sleeps
+   until another thread calls futex_wake() on it.  The check and
+   the sleep are atomic with respect to futex_wake().  Returns 0
+   after being woken, 1 if the int held some other value, or -1
+   if UADDR is not an aligned int in mapped user memory or
+   memory allocation fails.  Waking up does not imply anything
+   about the int's value, so callers should check it again. */
+int
+futex_wait (int *uaddr, int expected)
+{
+  const int *key = futex_key (uaddr);
+  struct futex *f;
+
+  if (key == NULL)
+    return -1;
+
+  lock_acquire (&futex_lock);
+  if (*key != expected)
+    {
+      lock_release (&futex_lock);
+      return 1;
+    }
+  f = find_futex (key);
+  if (f == NULL)
+    {
+      f = malloc (sizeof *f);
+      if (f == NULL)
+        {
+          lock_release (&futex_lock);
+          return -1;
+        }
+      f->key = key;
+      sema_init (&f->sema, 0);
+      f->waiter_cnt = f->user_cnt = 0;
+      hash_insert (&futexes, &f->elem);
+    }
+  f->waiter_cnt++;
+  f->user_cnt++;
+  lock_release (&futex_lock);
+
+  /* A wakeup that comes in between is not lost: it leaves the
+     semaphore up for us. */
+  sema_down (&f->sema);
+
+  lock_acquire (&futex_lock);
+  if (--f->user_cnt == 0)
+    {
+      hash_delete (&futexes, &f->elem);
+      free (f);
+    }
+  lock_release (&futex_lock);
+  return 0;
+}
+
+/* Wakes up to WAKE_CNT threads waiting on the int at user
+   address UADDR.  Returns the number of threads woken, or -1 if
+   UADDR is not an aligned int in mapped user memory. */
+int
+futex_wake (int *uaddr, int wake_cnt)
+{
+  const int *key = futex_key (uaddr);
+  struct futex *f;
+  int woken = 0;
+
+  if (key == NULL)
+    return -1;
+
+  lock_acquire (&futex_lock);
+  f = find_futex (key);
+  if (f != NULL)
+    for (; woken < wake_cnt && f->waiter_cnt > 0; woken++)
+      {
+        f->waiter_cnt--;
+        sema_up (&f->sema);
+      }
+  lock_release (&futex_lock);
+  return woken;
+}
+
+/* Returns the kernel address through which the running process
+   reaches the int at user address UADDR, or a null pointer if
+   UADDR is not an aligned int in mapped user memory. */
+static const int *
+futex_key (const int *uaddr)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+
+  if ((uintptr_t) uaddr % sizeof *uaddr != 0
+      || !validate_user_range (pd, uaddr, sizeof *uaddr, false))
+    return NULL;
+  return pagedir_get_page (pd, uaddr);
+}
+
+/* Returns the futex for KEY, or a null pointer if no thread is
+   waiting on it.  futex_lock must be held. */
+static struct futex *
+find_futex (const int *key)
+{
+  struct futex f;
+  struct hash_elem *e;
+
+  f.key = key;
+  e = hash_find (&futexes, &f.elem);
+  return e != NULL ? hash_entry (e, struct futex, elem) : NULL;
+}
+
+/* Returns a hash value for futex E. */
+static unsigned
+futex_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct futex *f = hash_entry (e, struct futex, elem);
+  return hash_bytes (&f->key, sizeof f->key);
+}
+
+/* Returns true if futex A precedes futex B. */
+static bool
+futex_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct futex *a = hash_entry (a_, struct futex, elem);
+  const struct futex *b = hash_entry (b_, struct futex, elem);
+  return a->key < b->key;
+}
@@ -2,12 +2,23 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include <round.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "userprog/rlimit.h"
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static bool frame_refs_init (void);
+
+/* Sharing counts for user frames, indexed by physical page
+   number.  A frame mapped by N page directories has a count of
+   N - 1, so frames that were never shared need no bookkeeping.
+   Allocated by the first pagedir_fork(), and accessed only with
+   interrupts off. */
+static uint16_t *frame_refs;
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -16,9 +27,15 @@ static void invalidate_pagedir (uint32_t *);
 uint32_t *
 pagedir_create (void) 
 {
-  uint32_t *pd = palloc_get_page (0);
+  uint32_t *pd;
+
+  if (!res_charge (RES_KPAGES, 1))
+    return NULL;
+  pd = palloc_get_page (0);
   if (pd != NULL)
     memcpy (pd, base_page_dir, PGSIZE);
+  else
+    res_release (RES_KPAGES, 1);
   return pd;
 }
 
@@ -41,12 +58,75 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            pagedir_release_frame (pte_get_page (*pte));
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
 }
 
+/* Returns the index of the sharing count for KPAGE in
+   frame_refs[]. */
+static size_t
+frame_no (const void *kpage)
+{
+  return vtop (kpage) >> PGBITS;
+}
+
+/* Allocates frame_refs[] if that has not been done yet.
+   Returns true if successful, false if memory allocation
+   fails. */
+static bool
+frame_refs_init (void)
+{
+  enum intr_level old_level;
+  size_t page_cnt;
+  uint16_t *refs;
+
+  if (frame_refs != NULL)
+    return true;
+
+  page_cnt = DIV_ROUND_UP (ram_pages * sizeof *frame_refs, PGSIZE);
+  refs = palloc_get_multiple (PAL_ZERO, page_cnt);
+  if (refs == NULL)
+    return false;
+
+  old_level = intr_disable ();
+  if (frame_refs == NULL)
+    {
+      frame_refs = refs;
+      refs = NULL;
+    }
+  intr_set_level (old_level);
+  if (refs != NULL)
+    palloc_free_multiple (refs, page_cnt);
+  return true;
+}
+
+/* Adds a reference to user frame KPAGE. */
+static void
+frame_share (void *kpage)
+{
+  enum intr_level old_level = intr_disable ();
+  frame_refs[frame_no (kpage)]++;
+  intr_set_level (old_level);
+}
+
+/* Drops a reference to user frame KPAGE, freeing it if it is no
+   longer mapped anywhere.  A frame obtained from palloc starts
+   out with one reference, held by whoever allocated it. */
+void
+pagedir_release_frame (void *kpage)
+{
+  enum intr_level old_level = intr_disable ();
+  bool last = frame_refs == NULL || frame_refs[frame_no (kpage)] == 0;
+  if (!last)
+    frame_refs[frame_no (kpage)]--;
+  intr_set_level (old_level);
+
+  if (last)
+    palloc_free_page (kpage);
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
@@ -70,9 +150,14 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
     {
       if (create)
         {
+          if (!res_charge (RES_KPAGES, 1))
+            return NULL;
           pt = palloc_get_page (PAL_ZERO);
           if (pt == NULL) 
-            return NULL; 
+            {
+              res_release (RES_KPAGES, 1);
+              return NULL; 
+            }
       
           *pde = pde_create (pt);
         }
@@ -106,6 +191,8 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
   ASSERT (vtop (kpage) >> PTSHIFT < ram_pages);
   ASSERT (pd != base_page_dir);
 
+  if (!res_charge (RES_FRAMES, 1))
+    return false;
   pte = lookup_page (pd, upage, true);
 
   if (pte != NULL) 
@@ -115,7 +202,10 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
       return true;
     }
   else
-    return false;
+    {
+      res_release (RES_FRAMES, 1);
+      return false;
+    }
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -136,6 +226,163 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
     return NULL;
 }
 
+/* Returns true if all SIZE bytes starting at user virtual
+   address UADDR are mapped user memory in PD, and also writable
+   if WRITABLE is true.  Copy-on-write pages count as writable,
+   since writing to them only causes them to be copied.  Each
+   page in the range is looked up only once, however large the
+   range is. */
+bool
+validate_user_range (uint32_t *pd, const void *uaddr, size_t size,
+                     bool writable)
+{
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+  const uint8_t *upage;
+  uint32_t required = PTE_P | PTE_U | (writable ? PTE_W : 0);
+
+  if (size == 0)
+    return true;
+  if (end < (const uint8_t *) uaddr || (const void *) end > PHYS_BASE)
+    return false;
+
+  for (upage = pg_round_down (uaddr); upage < end; upage += PGSIZE)
+    {
+      uint32_t *pte = lookup_page (pd, upage, false);
+      uint32_t flags = pte != NULL ? *pte : 0;
+      if (flags & PTE_COW)
+        flags |= PTE_W;
+      if ((flags & required) != required)
+        return false;
+    }
+  return true;
+}
+
+/* Makes CHILD, a page directory with no user mappings, map the
+   same frames as PARENT at the same user addresses.  Writable
+   pages become read-only copy-on-write pages in both, to be
+   copied by pagedir_copy_on_write() when either side writes to
+   them, except for shared memory, which stays shared.  Returns
+   true if successful, false if memory allocation failed or the
+   running process is over its limits, in which case CHILD
+   should be destroyed.  The mapped frames count against the
+   running process's limits, so this should be called by the
+   process that will own CHILD. */
+bool
+pagedir_fork (uint32_t *child, uint32_t *parent)
+{
+  uint32_t *pde;
+
+  if (!frame_refs_init ())
+    return false;
+
+  for (pde = parent; pde < parent + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P)
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        size_t i;
+
+        for (i = 0; i < PGSIZE / sizeof *pt; i++)
+          if (pt[i] & PTE_P)
+            {
+              void *upage = (void *) (((uintptr_t) (pde - parent) << PDSHIFT)
+                                      | (i << PTSHIFT));
+              uint32_t *pte;
+              if (!res_charge (RES_FRAMES, 1))
+                return false;
+              pte = lookup_page (child, upage, true);
+              if (pte == NULL)
+                {
+                  res_release (RES_FRAMES, 1);
+                  return false;
+                }
+
+              if ((pt[i] & (PTE_W | PTE_SHARED)) == PTE_W)
+                pt[i] = (pt[i] & ~(uint32_t) PTE_W) | PTE_COW;
+              *pte = pt[i] & ~(uint32_t) (PTE_A | PTE_D);
+              frame_share (pte_get_page (pt[i]));
+            }
+      }
+  invalidate_pagedir (parent);
+  return true;
+}
+
+/* Handles a write to copy-on-write page UPAGE in PD by giving PD
+   a private, writable copy of the frame, or by simply making the
+   page writable if no other page directory maps the frame any
+   more.  Returns true if successful, false if UPAGE is not a
+   copy-on-write page or memory allocation failed. */
+bool
+pagedir_copy_on_write (uint32_t *pd, const void *upage)
+{
+  enum intr_level old_level;
+  uint32_t *pte;
+  void *kpage, *copy;
+  bool shared;
+
+  pte = lookup_page (pd, upage, false);
+  if (pte == NULL || (*pte & (PTE_P | PTE_COW)) != (PTE_P | PTE_COW))
+    return false;
+  kpage = pte_get_page (*pte);
+
+  old_level = intr_disable ();
+  shared = frame_refs[frame_no (kpage)] > 0;
+  intr_set_level (old_level);
+
+  if (shared)
+    {
+      copy = palloc_get_page (PAL_USER);
+      if (copy == NULL)
+        return false;
+      memcpy (copy, kpage, PGSIZE);
+      *pte = pte_create_user (copy, true);
+      pagedir_release_frame (kpage);
+    }
+  else
+    *pte = (*pte & ~(uint32_t) PTE_COW) | PTE_W;
+  invalidate_pagedir (pd);
+  return true;
+}
+
+/* Maps user virtual page UPAGE in PD to KPAGE, a frame of
+   shared memory, writably, and takes a reference to KPAGE that
+   is dropped when the mapping goes away.  The mapping is kept
+   shared, not copied, across pagedir_fork().  UPAGE must not
+   already be mapped.  Returns true if successful, false if
+   memory allocation failed. */
+bool
+pagedir_share_page (uint32_t *pd, void *upage, void *kpage)
+{
+  uint32_t *pte;
+
+  if (!frame_refs_init () || !pagedir_set_page (pd, upage, kpage, true))
+    return false;
+  pte = lookup_page (pd, upage, false);
+  *pte |= PTE_SHARED;
+  frame_share (kpage);
+  return true;
+}
+
+/* Removes the mapping for user virtual page UPAGE from PD, if
+   any, and drops its reference to the frame it mapped. */
+void
+pagedir_unmap (uint32_t *pd, void *upage)
+{
+  uint32_t *pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (pd, upage, false);
+  if (pte != NULL && (*pte & PTE_P) != 0)
+    {
+      void *kpage = pte_get_page (*pte);
+      *pte = 0;
+      invalidate_pagedir (pd);
+      pagedir_release_frame (kpage);
+      res_release (RES_FRAMES, 1);
+    }
+}
+
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
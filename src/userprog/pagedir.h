@@ -2,12 +2,20 @@
 #define USERPROG_PAGEDIR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 uint32_t *pagedir_create (void);
 void pagedir_destroy (uint32_t *pd);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
+bool validate_user_range (uint32_t *pd, const void *uaddr, size_t size,
+                          bool writable);
+bool pagedir_fork (uint32_t *child, uint32_t *parent);
+bool pagedir_copy_on_write (uint32_t *pd, const void *upage);
+bool pagedir_share_page (uint32_t *pd, void *upage, void *kpage);
+void pagedir_unmap (uint32_t *pd, void *upage);
+void pagedir_release_frame (void *kpage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
@@ -0,0 +1,162 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Size of a pipe's buffer. */
+#define PIPE_SIZE PGSIZE
+
+/* A pipe: a one-page ring buffer shared by a set of readers and
+   a set of writers.
+
+   HEAD and TAIL count the bytes ever written and read, so
+   HEAD - TAIL bytes are buffered, starting at BUF[TAIL %
+   PIPE_SIZE].  Data is moved in bulk, with at most two memcpy()
+   calls per transfer, straight between the ring and the caller's
+   buffer. */
+struct pipe
+  {
+    struct lock lock;           /* Protects all other members. */
+    struct condition readable;  /* Data arrived or last writer left. */
+    struct condition writable;  /* Space freed or last reader left. */
+    uint8_t *buf;               /* PIPE_SIZE bytes of data. */
+    size_t head;                /* Bytes written so far. */
+    size_t tail;                /* Bytes read so far. */
+    int readers;                /* Number of open read ends. */
+    int writers;                /* Number of open write ends. */
+  };
+
+/* Creates a pipe with one read end and one write end open.
+   Returns the new pipe, or a null pointer if memory allocation
+   fails. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+
+  p->buf = palloc_get_page (0);
+  if (p->buf == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  lock_init (&p->lock);
+  cond_init (&p->readable);
+  cond_init (&p->writable);
+  p->head = p->tail = 0;
+  p->readers = p->writers = 1;
+  return p;
+}
+
+/* Opens another read end of P, or write end if WRITER is true. */
+void
+pipe_reopen (struct pipe *p, bool writer)
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+}
+
+/* Closes a read end of P, or write end if WRITER is true, and
+   frees P once both of its ends are fully closed. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool unused;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writers > 0);
+      if (--p->writers == 0)
+        cond_broadcast (&p->readable, &p->lock);
+    }
+  else
+    {
+      ASSERT (p->readers > 0);
+      if (--p->readers == 0)
+        cond_broadcast (&p->writable, &p->lock);
+    }
+  unused = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (unused)
+    {
+      palloc_free_page (p->buf);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into BUFFER, waiting until at
+   least one byte is available unless SIZE is 0.  Returns the
+   number of bytes read, which is 0 at end of file, that is, when
+   P is empty and has no writers left. */
+int
+pipe_read (struct pipe *p, void *buffer, size_t size)
+{
+  size_t n, ofs, first;
+
+  lock_acquire (&p->lock);
+  while (size > 0 && p->head == p->tail && p->writers > 0)
+    cond_wait (&p->readable, &p->lock);
+
+  n = p->head - p->tail;
+  if (n > size)
+    n = size;
+  ofs = p->tail % PIPE_SIZE;
+  first = n < PIPE_SIZE - ofs ? n : PIPE_SIZE - ofs;
+  memcpy (buffer, p->buf + ofs, first);
+  memcpy ((uint8_t *) buffer + first, p->buf, n - first);
+  p->tail += n;
+
+  if (n > 0)
+    cond_broadcast (&p->writable, &p->lock);
+  lock_release (&p->lock);
+
+  return n;
+}
+
+/* Writes SIZE bytes from BUFFER into P, waiting for space as
+   needed.  Returns the number of bytes written, which is less
+   than SIZE only if P's last reader goes away, or -1 if P had no
+   readers to begin with. */
+int
+pipe_write (struct pipe *p, const void *buffer, size_t size)
+{
+  size_t written = 0;
+  int result;
+
+  lock_acquire (&p->lock);
+  while (written < size && p->readers > 0)
+    {
+      size_t space = PIPE_SIZE - (p->head - p->tail);
+      size_t n, ofs, first;
+
+      if (space == 0)
+        {
+          cond_wait (&p->writable, &p->lock);
+          continue;
+        }
+
+      n = size - written < space ? size - written : space;
+      ofs = p->head % PIPE_SIZE;
+      first = n < PIPE_SIZE - ofs ? n : PIPE_SIZE - ofs;
+      memcpy (p->buf + ofs, (const uint8_t *) buffer + written, first);
+      memcpy (p->buf, (const uint8_t *) buffer + written + first, n - first);
+      p->head += n;
+      written += n;
+      cond_broadcast (&p->readable, &p->lock);
+    }
+  result = written > 0 || p->readers > 0 ? (int) written : -1;
+  lock_release (&p->lock);
+
+  return result;
+}
@@ -5,12 +5,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/fdtable.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/rlimit.h"
+#include "userprog/shm.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
@@ -20,9 +24,42 @@
 #include "threads/malloc.h"
 #include "threads/synch.h"
 
+/* A process's children, created when it first starts one.
+
+   BY_TID is used only by the process itself.  EXITED is added to
+   by exiting children, which is safe as long as the process is
+   still alive; see child_exited(). */
+struct children
+  {
+    struct hash by_tid;         /* pc_status blocks, by child_id. */
+    struct list exited;         /* Exited children not yet waited for. */
+    struct lock lock;           /* Protects EXITED. */
+    struct condition exited_cond; /* Signaled when a child exits. */
+  };
+
+/* Protects the exec image cache.  See exec_cache_get(). */
+static struct lock exec_cache_lock;
+
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
+static struct pc_status *pcs_create (const char *cmd_line);
+static void pcs_release (struct pc_status *);
+static struct children *get_children (void);
+static struct pc_status *find_child (tid_t);
+static int reap_child (struct pc_status *);
+static void child_exited (struct pc_status *);
+static void release_child (struct hash_elem *, void *aux);
+static tid_t start_child (tid_t, struct pc_status *);
+static void finish_start (struct pc_status *, bool success);
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
+/* Initializes the user program loader. */
+void
+process_init (void)
+{
+  lock_init (&exec_cache_lock);
+}
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -30,44 +67,291 @@ static bool load (const char *cmdline, void (**eip) (void), void **esp);
 tid_t
 process_execute (const char *file_name)
 {
-  char *fn_copy;
+  /* Make a copy of FILE_NAME at the end of the status block.
+     Otherwise there's a race between the caller and load(). */
+  struct pc_status *pcs = pcs_create (file_name);
+  if (pcs == NULL)
+    return TID_ERROR;
+
+  /* Create a new thread to execute FILE_NAME. */
+  return start_child (thread_create (pcs->f_name, PRI_DEFAULT,
+                                     start_process, pcs), pcs);
+}
+
+/* Like process_execute(), but returns as soon as the new thread
+   has been created, without waiting for it to load FILE_NAME, so
+   that a process can start several children whose loads
+   overlap.  Use process_exec_status() to find out whether the
+   load succeeded.  A child that fails to load exits with status
+   -1. */
+tid_t
+process_execute_async (const char *file_name)
+{
+  struct pc_status *pcs = pcs_create (file_name);
   tid_t tid;
 
-  struct pc_status *pcs = (struct pc_status*)malloc(sizeof(struct pc_status));
+  if (pcs == NULL)
+    return TID_ERROR;
+
+  tid = thread_create (pcs->f_name, PRI_DEFAULT, start_process, pcs);
+  if (tid == TID_ERROR) {
+    free(pcs);
+    return TID_ERROR;
+  }
+
+  pcs->child_id = tid;
+  hash_insert(&pcs->owner->by_tid, &pcs->hash_elem);
+  return tid;
+}
+
+/* Waits for child process TID to finish loading and returns 1 if
+   it loaded successfully, 0 if it did not, or -1 if TID is not a
+   child of the running process that has not yet been waited
+   for. */
+int
+process_exec_status (tid_t child_tid)
+{
+  struct pc_status *pcs = find_child (child_tid);
+
+  if (pcs == NULL)
+    return -1;
+
+  /* sema_exec is upped once, when loading finishes, so put the
+     value back for any later caller. */
+  sema_down(&pcs->sema_exec);
+  sema_up(&pcs->sema_exec);
+  return pcs->exec_success;
+}
+
+/* Information passed from process_fork() to start_fork(). */
+struct fork_info
+  {
+    struct pc_status *pcs;      /* Status block shared with the parent. */
+    struct thread *parent;      /* Process being forked. */
+    struct intr_frame if_;      /* Parent's user context. */
+  };
+
+/* Starts a new process that is a copy of the running process,
+   sharing its memory copy-on-write and with its own copy of its
+   file descriptor table.  The child resumes in user mode at the
+   same point as the parent, as described by IF_, but with 0 as
+   the return value.  Returns the child's thread id, or TID_ERROR
+   if the child cannot be created. */
+tid_t
+process_fork (const struct intr_frame *if_)
+{
+  struct fork_info info;
+
+  info.pcs = pcs_create ("");
+  if (info.pcs == NULL)
+    return TID_ERROR;
+  info.parent = thread_current ();
+  info.if_ = *if_;
+
+  /* INFO lives on our stack, which is fine because we wait for
+     the child to finish with it. */
+  return start_child (thread_create (thread_name (), PRI_DEFAULT,
+                                     start_fork, &info), info.pcs);
+}
+
+/* Creates a status block for a child of the running process
+   whose command line is CMD_LINE, or returns a null pointer if
+   CMD_LINE is PGSIZE - 1 bytes or longer or if memory
+   allocation fails. */
+static struct pc_status *
+pcs_create (const char *cmd_line)
+{
+  size_t len = strnlen (cmd_line, PGSIZE);
+  struct children *children;
+  struct pc_status *pcs;
+
+  if (len >= PGSIZE - 1)
+    return NULL;
+  children = get_children ();
+  if (children == NULL)
+    return NULL;
+  pcs = malloc (sizeof *pcs + len + 1);
+  if (pcs == NULL)
+    return NULL;
+  pcs->owner = children;
+  memcpy (pcs->f_name, cmd_line, len);
+  pcs->f_name[len] = '\0';
+
   sema_init(&pcs->sema_exec, 0);
   sema_init(&pcs->sema_wait, 0);
   lock_init(&pcs->exit_lock);
 
   pcs->alive_count = 2;
+  pcs->exit_status = -1;
+  return pcs;
+}
 
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
-    return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+/* Drops one of the two references to PCS, held by the parent and
+   the child, freeing PCS when both are gone. */
+static void
+pcs_release (struct pc_status *pcs)
+{
+  bool last;
 
-  pcs->f_name = fn_copy;
+  lock_acquire(&pcs->exit_lock);
+  last = --pcs->alive_count == 0;
+  lock_release(&pcs->exit_lock);
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create(fn_copy, PRI_DEFAULT, start_process, pcs);
+  if (last)
+    free(pcs);
+}
+
+/* Returns a hash value for the pc_status block containing E. */
+static unsigned
+child_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct pc_status *pcs = hash_entry (e, struct pc_status, hash_elem);
+  return hash_int (pcs->child_id);
+}
+
+/* Returns true if pc_status block A precedes B. */
+static bool
+child_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct pc_status *a = hash_entry (a_, struct pc_status, hash_elem);
+  const struct pc_status *b = hash_entry (b_, struct pc_status, hash_elem);
+  return a->child_id < b->child_id;
+}
+
+/* Returns the running thread's set of children, creating it if
+   necessary, or a null pointer if memory allocation fails. */
+static struct children *
+get_children (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->children == NULL)
+    {
+      struct children *c = malloc (sizeof *c);
+      if (c == NULL)
+        return NULL;
+      if (!hash_init (&c->by_tid, child_hash, child_less, NULL))
+        {
+          free (c);
+          return NULL;
+        }
+      list_init (&c->exited);
+      lock_init (&c->lock);
+      cond_init (&c->exited_cond);
+      t->children = c;
+    }
+  return t->children;
+}
+
+/* Returns the status block of the running thread's child TID, or
+   a null pointer if there is no such child. */
+static struct pc_status *
+find_child (tid_t child_tid)
+{
+  struct children *c = thread_current ()->children;
+  struct pc_status key;
+  struct hash_elem *e;
+
+  if (c == NULL)
+    return NULL;
+  key.child_id = child_tid;
+  e = hash_find (&c->by_tid, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct pc_status, hash_elem) : NULL;
+}
+
+/* Waits for child PCS of the running thread to exit, forgets
+   about it, and returns its exit status. */
+static int
+reap_child (struct pc_status *pcs)
+{
+  struct children *c = pcs->owner;
+  int exit_status;
+
+  sema_down(&pcs->sema_wait);
+
+  lock_acquire (&c->lock);
+  list_remove (&pcs->exited_elem);
+  lock_release (&c->lock);
+  hash_delete (&c->by_tid, &pcs->hash_elem);
+
+  exit_status = pcs->exit_status;
+  pcs_release(pcs);
+  return exit_status;
+}
+
+/* Tells the parent of the running process, through PCS, that the
+   process is exiting.  If the parent is still alive, PCS is
+   queued on its list of exited children, for
+   process_wait_any(). */
+static void
+child_exited (struct pc_status *pcs)
+{
+  lock_acquire(&pcs->exit_lock);
+  if (pcs->alive_count == 2)
+    {
+      struct children *c = pcs->owner;
+      lock_acquire (&c->lock);
+      list_push_back (&c->exited, &pcs->exited_elem);
+      cond_signal (&c->exited_cond, &c->lock);
+      lock_release (&c->lock);
+    }
+  lock_release(&pcs->exit_lock);
+
+  sema_up(&pcs->sema_wait);
+  pcs_release(pcs);
+}
+
+/* Drops the running process's reference to child PCS, an element
+   of its set of children. */
+static void
+release_child (struct hash_elem *e, void *aux UNUSED)
+{
+  pcs_release (hash_entry (e, struct pc_status, hash_elem));
+}
+
+/* Waits for child thread TID, which was passed PCS, to finish
+   starting up.  Returns TID if it succeeded, in which case PCS is
+   added to the running thread's children, or TID_ERROR if it
+   failed, in which case our reference to PCS is dropped. */
+static tid_t
+start_child (tid_t tid, struct pc_status *pcs)
+{
   if (tid == TID_ERROR) {
     free(pcs);
-    palloc_free_page(fn_copy);
   }
   else {
     sema_down(&pcs->sema_exec);
+    sema_up(&pcs->sema_exec);
 
     if(!pcs->exec_success) {
-      free(pcs);
+      reap_child(pcs);
       return TID_ERROR;
     }
 
-    list_push_back(&thread_current()->child_list, &pcs->elem);
+    hash_insert(&pcs->owner->by_tid, &pcs->hash_elem);
   }
   return tid;
 }
 
+/* Signals to the parent that the running process has started
+   successfully if SUCCESS is true, or exits with status -1 if it
+   is false.  Either way the process's exit is reported through
+   PCS like any other. */
+static void
+finish_start (struct pc_status *pcs, bool success)
+{
+  struct thread *t = thread_current();
+
+  t->parent_pcs = pcs;
+  pcs->child_id = t->tid;
+  pcs->exec_success = success;
+  sema_up(&pcs->sema_exec);
+
+  if (!success)
+    thread_exit ();
+}
+
 /* A thread function that loads a user process and starts it
    running. */
 static void
@@ -84,21 +368,9 @@ start_process (void *pcs_)
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
   success = load (file_name, &if_.eip, &if_.esp);
-  pcs->exec_success = success;
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
-
-  if (!success) {
-    sema_up(&pcs->sema_exec);
-    thread_exit ();
-  }
-  else {
-    struct thread *t = thread_current();
-    t->parent_pcs = pcs;
-    pcs->child_id = t->tid;
-    sema_up(&pcs->sema_exec);
-  }
+  finish_start (pcs, success);
 
   /* Start the user process by simulating a return from an
      interrupt, implemented by intr_exit (in
@@ -110,6 +382,44 @@ start_process (void *pcs_)
   NOT_REACHED ();
 }
 
+/* A thread function that turns a new thread into a copy of the
+   process described by INFO_, a struct fork_info, and starts it
+   running. */
+static void
+start_fork (void *info_)
+{
+  struct fork_info *info = info_;
+  struct thread *parent = info->parent;
+  struct thread *t = thread_current ();
+  struct intr_frame if_ = info->if_;
+  bool success = false;
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL || !pagedir_fork (t->pagedir, parent->pagedir))
+    goto done;
+  process_activate ();
+
+  if (parent->fds != NULL)
+    {
+      t->fds = fd_table_clone (parent->fds);
+      if (t->fds == NULL
+          || !res_charge (RES_FILES, parent->rusage.cur[RES_FILES]))
+        goto done;
+    }
+  t->ring = parent->ring;
+  if (!shm_fork (parent))
+    goto done;
+
+  if_.eax = 0;
+  success = true;
+
+ done:
+  finish_start (info->pcs, success);
+
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -122,21 +432,40 @@ start_process (void *pcs_)
 int
 process_wait (tid_t child_tid)
 {
-    struct thread *t = thread_current();
-    if (!list_empty(&t->child_list)) {
-        struct list_elem *e;
-        for (e = list_begin(&t->child_list); e != list_end(&t->child_list); e = list_next(e)) {
-            struct pc_status *pcs = list_entry(e, struct pc_status, elem);
-            if (pcs->child_id == child_tid) {
-                sema_down(&pcs->sema_wait);
-                int exit_status = pcs->exit_status;
-                list_remove(e);
-                free(pcs);
-                return exit_status;
-            }
+    struct pc_status *pcs = find_child(child_tid);
+    if (pcs != NULL)
+        return reap_child(pcs);
+    return -1;
+}
+
+/* Waits for any child of the running process to exit, stores its
+   exit status in *STATUS and returns its thread id.  Children
+   are reaped in the order in which they exit.  Returns TID_ERROR
+   immediately if the process has no children left to wait
+   for. */
+tid_t
+process_wait_any (int *status)
+{
+    struct children *c = thread_current()->children;
+    struct pc_status *pcs;
+
+    if (c == NULL)
+        return TID_ERROR;
+
+    lock_acquire(&c->lock);
+    while (list_empty(&c->exited)) {
+        if (hash_empty(&c->by_tid)) {
+            lock_release(&c->lock);
+            return TID_ERROR;
         }
+        cond_wait(&c->exited_cond, &c->lock);
     }
-    return -1;
+    pcs = list_entry(list_front(&c->exited), struct pc_status, exited_elem);
+    lock_release(&c->lock);
+
+    tid_t tid = pcs->child_id;
+    *status = reap_child(pcs);
+    return tid;
 }
 
 /* Free the current process's resources. */
@@ -146,6 +475,17 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  if (cur->pagedir != NULL)
+    rusage_print ();
+
+  /* Close all open files. */
+  fd_table_destroy (cur->fds);
+  cur->fds = NULL;
+
+  /* Detach shared memory, while its mappings are still there to
+     remove. */
+  shm_exit ();
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -163,32 +503,18 @@ process_exit (void)
       pagedir_destroy (pd);
     }
 
-    // free pcs for children
-    if (!list_empty(&cur->child_list)) {
-        struct list_elem *e;
-        for (e = list_begin (&cur->child_list); e != list_end (&cur->child_list);
-             e = list_remove(e)) {
-            struct pc_status *pcs = list_entry(e, struct pc_status, elem);
-            if (pcs) {
-                lock_acquire(&pcs->exit_lock);
-                if (--(pcs->alive_count) == 0)
-                    free(pcs);
-                lock_release(&pcs->exit_lock);
-            }
-        }
+    // free pcs for children; once they are released, no child
+    // touches the set any more
+    if (cur->children != NULL) {
+        hash_destroy(&cur->children->by_tid, release_child);
+        free(cur->children);
+        cur->children = NULL;
     }
 
     // free the parent pcs
     if(cur->parent_pcs) {
-        lock_acquire(&cur->parent_pcs->exit_lock);
-        if (--(cur->parent_pcs->alive_count) == 0) {
-            sema_up(&cur->parent_pcs->sema_wait);
-            free(cur->parent_pcs);
-        }
-        else {
-            sema_up(&cur->parent_pcs->sema_wait);
-        }
-        lock_release(&cur->parent_pcs->exit_lock);
+        child_exited(cur->parent_pcs);
+        cur->parent_pcs = NULL;
     }
 
 }
@@ -272,7 +598,39 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp);
+/* A loadable segment, as laid out by load_segment(). */
+struct exec_segment
+  {
+    uint32_t file_page;         /* Page-aligned offset in the file. */
+    uint32_t mem_page;          /* Page-aligned user virtual address. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after them. */
+    bool writable;              /* Whether the pages are writable. */
+  };
+
+/* What load() needs to know about an executable, besides the
+   contents of its segments. */
+struct exec_image
+  {
+    disk_sector_t sector;       /* Executable file's inode sector. */
+    struct inode *inode;        /* Executable file, while cached. */
+    unsigned write_cnt;         /* inode_write_cnt() when parsed. */
+    uint32_t entry;             /* Entry point. */
+    int seg_cnt;                /* Number of loadable segments. */
+    struct exec_segment *segs;  /* Loadable segments. */
+    unsigned last_used;         /* For exec cache replacement. */
+  };
+
+static bool count_args (const char *cmd_line, int *argc,
+                        size_t *str_size);
+static size_t args_size (int argc, size_t str_size);
+static char **push_args (const char *cmd_line, int argc, size_t str_size,
+                         void **esp);
+static bool setup_stack (void **esp, size_t size);
+static bool read_image (struct file *, const char *file_name,
+                        struct exec_image *);
+static bool exec_cache_get (struct inode *, struct exec_image *);
+static void exec_cache_put (const struct exec_image *);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
@@ -281,93 +639,34 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 /* Loads an ELF executable from FILE_NAME into the current thread.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
+   FILE_NAME is the whole command line; its first word names the
+   executable and all of its words are passed as arguments.
    Returns true if successful, false otherwise. */
 bool
 load (const char *file_name, void (**eip) (void), void **esp)
 {
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  struct exec_image image;
   struct file *file = NULL;
-  off_t file_ofs;
   bool success = false;
   int i;
 
+  image.segs = NULL;
+
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL)
     goto done;
   process_activate ();
 
-  /* Set up stack. */
-  if (!setup_stack (esp)){
+  /* Set up stack, with the arguments at the top. */
+  int argc;
+  size_t str_size;
+  if (!count_args (file_name, &argc, &str_size) || argc == 0)
     goto done;
-  }
-
-
-
-  /*
-  The strtok_r() function is a reentrant version strtok(). The saveptr
-  argument is a pointer to a char * variable that is used internally by
-  strtok_r() in order to maintain context between successive calls that
-  parse the same string.
-
-  On the first call to strtok_r(), str should point to the string to be
-  parsed, and the value of saveptr is ignored. In subsequent calls, str
-  should be NULL, and saveptr should be unchanged since the previous call.
-
-  **Copied from strtok_r documentation in c**
-  */
-
-
-  char *s, *token, *save_ptr;
-  char *argv[32];
-  char *addr[32];
-
-  s = palloc_get_page (0);
-  if (s == NULL)
+  if (!setup_stack (esp, args_size (argc, str_size)))
     goto done;
-  strlcpy(s, file_name, PGSIZE);
-
-  //tokenize the string and save each token as an argument
-  int arg_num = 0;
-  for (token = strtok_r(s, " ", &save_ptr); token != NULL;
-       token = strtok_r(NULL, " ", &save_ptr)) {
-           argv[arg_num] = token;
-           ++arg_num;
-       }
-
-  int j;
-  --(*esp);                           //stack starts below PHYS_BASE
-  for (j = arg_num-1; j >= 0; --j) {
-      *((char*)*esp) = '\0';          //**esp -> *esp -> esp = "\0"
-
-      /* Go to end of argument, memcpy copies
-      upwards and we want to go downwards */
-      *esp -= strlen(argv[j]);
-      memcpy(*esp, argv[j], strlen(argv[j]));
-
-      addr[j] = *esp;                 //save mem addr of argv[j]
-      --(*esp);                       //dec pointer to prepare for the next arg
-  }
-
-  while((int)(*esp)%4 != 0) --*esp;   //word align
-  *esp -= 4;                          //start next segment 1 page below last one
-  *((char**)(*esp)) = NULL;           //argv[argc] == NULL
-
-
-  *esp -= 4;                          //push addr of args below NULL
-  for (j = arg_num-1; j >= 0; --j) {
-      *((char**)*esp) = addr[j];      //push addr[j] on stack
-      *esp -= 4;                      //go to next empty addr on stack
-  }
-  *((char**)*esp) = (char*)*esp + 4;  //push argv start addr on stack
-
-  *esp -= 4;
-  *((int*)*esp) = arg_num;            //push arg_num (argc) on stack
-
-  *esp -= 4;
-  *((void**)*esp) = NULL;             //push return addr on stack
-  file_name = argv[0];                //set file_name
+  file_name = push_args (file_name, argc, str_size, esp)[0];
 
    /* Uncomment the following line to print some debug
      information. This will be useful when you debug the program
@@ -416,6 +715,50 @@ load (const char *file_name, void (**eip) (void), void **esp)
       goto done;
     }
 
+  /* Get the executable's layout, from the cache if possible. */
+  if (!exec_cache_get (file_get_inode (file), &image))
+    {
+      if (!read_image (file, file_name, &image))
+        goto done;
+      exec_cache_put (&image);
+    }
+
+  /* Load segments. */
+  for (i = 0; i < image.seg_cnt; i++)
+    {
+      struct exec_segment *seg = &image.segs[i];
+      if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+                         seg->read_bytes, seg->zero_bytes, seg->writable))
+        goto done;
+    }
+
+  /* Start address. */
+  *eip = (void (*) (void)) image.entry;
+
+  success = true;
+
+ done:
+  /* We arrive here whether the load is successful or not. */
+  free (image.segs);
+  file_close (file);
+  return success;
+}
+
+/* Reads and verifies the ELF headers of FILE, named FILE_NAME,
+   and stores the entry point and the layout of its loadable
+   segments in IMAGE, whose segs array is malloc()'d.  Returns
+   true if successful, false if FILE is not a valid executable. */
+static bool
+read_image (struct file *file, const char *file_name,
+            struct exec_image *image)
+{
+  struct Elf32_Ehdr ehdr;
+  off_t file_ofs;
+  int i;
+
+  image->inode = file_get_inode (file);
+  image->write_cnt = inode_write_cnt (image->inode);
+
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
       || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
@@ -426,9 +769,15 @@ load (const char *file_name, void (**eip) (void), void **esp)
       || ehdr.e_phnum > 1024)
     {
       printf ("load: %s: error loading executable\n", file_name);
-      goto done;
+      return false;
     }
 
+  image->entry = ehdr.e_entry;
+  image->seg_cnt = 0;
+  image->segs = malloc (ehdr.e_phnum * sizeof *image->segs);
+  if (image->segs == NULL && ehdr.e_phnum > 0)
+    return false;
+
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
   for (i = 0; i < ehdr.e_phnum; i++)
@@ -436,11 +785,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
       struct Elf32_Phdr phdr;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
+        return false;
       file_seek (file, file_ofs);
 
       if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        return false;
       file_ofs += sizeof phdr;
       switch (phdr.p_type)
         {
@@ -454,52 +803,179 @@ load (const char *file_name, void (**eip) (void), void **esp)
         case PT_DYNAMIC:
         case PT_INTERP:
         case PT_SHLIB:
-          goto done;
+          return false;
         case PT_LOAD:
           if (validate_segment (&phdr, file))
             {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
+              struct exec_segment *seg = &image->segs[image->seg_cnt++];
               uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
+              seg->writable = (phdr.p_flags & PF_W) != 0;
+              seg->file_page = phdr.p_offset & ~PGMASK;
+              seg->mem_page = phdr.p_vaddr & ~PGMASK;
               if (phdr.p_filesz > 0)
                 {
                   /* Normal segment.
                      Read initial part from disk and zero the rest. */
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
+                  seg->read_bytes = page_offset + phdr.p_filesz;
+                  seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz,
+                                               PGSIZE)
+                                     - seg->read_bytes);
                 }
               else
                 {
                   /* Entirely zero.
                      Don't read anything from disk. */
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+                  seg->read_bytes = 0;
+                  seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz,
+                                              PGSIZE);
                 }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
             }
           else
-            goto done;
+            return false;
           break;
         }
     }
+  return true;
+}
 
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+/* Exec image cache.
 
-  success = true;
+   Parsing an executable's headers costs several reads, so the
+   layouts of recently executed files are kept here, keyed by
+   inode sector.  Each cached inode is kept open, so that its
+   write count keeps counting and shows whether the file has been
+   modified since it was parsed.  So that this reference does not
+   keep a deleted file's sectors allocated, inode_remove() drops
+   the file from the cache, and so does filesys_done() for all
+   files at shutdown. */
 
- done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
-  palloc_free_page(s);
-  return success;
+/* Number of executables whose layout is cached. */
+#define EXEC_CACHE_SIZE 8
+
+static struct exec_image exec_cache[EXEC_CACHE_SIZE];
+static unsigned exec_cache_clock;     /* Ticks on every lookup, for LRU. */
+
+/* Frees cache entry E, which must be in use. */
+static void
+exec_cache_drop (struct exec_image *e)
+{
+  inode_close (e->inode);
+  free (e->segs);
+  e->inode = NULL;
+  e->segs = NULL;
+}
+
+/* Looks up INODE in the exec image cache.  If it is there and
+   INODE has not been written since it was cached, copies its
+   layout into IMAGE and returns true.  Otherwise returns false. */
+static bool
+exec_cache_get (struct inode *inode, struct exec_image *image)
+{
+  disk_sector_t sector = inode_get_inumber (inode);
+  bool found = false;
+  size_t i;
+
+  lock_acquire (&exec_cache_lock);
+  exec_cache_clock++;
+  for (i = 0; i < EXEC_CACHE_SIZE; i++)
+    {
+      struct exec_image *e = &exec_cache[i];
+      if (e->inode == NULL)
+        continue;
+
+      /* Don't keep deleted or modified files around. */
+      if (inode_is_removed (e->inode)
+          || inode_write_cnt (e->inode) != e->write_cnt)
+        exec_cache_drop (e);
+      else if (e->sector == sector)
+        {
+          struct exec_segment *segs = malloc (e->seg_cnt * sizeof *segs);
+          if (segs == NULL && e->seg_cnt > 0)
+            break;
+          memcpy (segs, e->segs, e->seg_cnt * sizeof *segs);
+          *image = *e;
+          image->segs = segs;
+          e->last_used = exec_cache_clock;
+          found = true;
+        }
+    }
+  lock_release (&exec_cache_lock);
+
+  return found;
+}
+
+/* Adds a copy of IMAGE to the exec image cache, replacing the
+   least recently used entry if the cache is full.  Failing to
+   allocate memory for the copy is not an error; IMAGE is simply
+   not cached. */
+static void
+exec_cache_put (const struct exec_image *image)
+{
+  struct exec_image *victim = &exec_cache[0];
+  disk_sector_t sector = inode_get_inumber (image->inode);
+  struct exec_segment *segs;
+  size_t i;
+
+  segs = malloc (image->seg_cnt * sizeof *segs);
+  if (segs == NULL && image->seg_cnt > 0)
+    return;
+  memcpy (segs, image->segs, image->seg_cnt * sizeof *segs);
+
+  lock_acquire (&exec_cache_lock);
+  for (i = 0; i < EXEC_CACHE_SIZE; i++)
+    {
+      struct exec_image *e = &exec_cache[i];
+      if (e->inode != NULL && e->sector == sector)
+        {
+          /* Someone else cached it first. */
+          lock_release (&exec_cache_lock);
+          free (segs);
+          return;
+        }
+      if (e->inode == NULL
+          || (victim->inode != NULL && e->last_used < victim->last_used))
+        victim = e;
+    }
+  if (victim->inode != NULL)
+    exec_cache_drop (victim);
+  *victim = *image;
+  victim->sector = sector;
+  victim->inode = inode_reopen (image->inode);
+  victim->segs = segs;
+  victim->last_used = exec_cache_clock;
+  lock_release (&exec_cache_lock);
 }
 
+/* Drops INODE, which is being removed, from the exec image
+   cache, so that the cache does not keep its sectors
+   allocated. */
+void
+process_forget_exec (struct inode *inode)
+{
+  disk_sector_t sector = inode_get_inumber (inode);
+  size_t i;
+
+  lock_acquire (&exec_cache_lock);
+  for (i = 0; i < EXEC_CACHE_SIZE; i++)
+    if (exec_cache[i].inode != NULL && exec_cache[i].sector == sector)
+      exec_cache_drop (&exec_cache[i]);
+  lock_release (&exec_cache_lock);
+}
+
+/* Empties the exec image cache, closing every cached inode, for
+   when the file system shuts down. */
+void
+process_forget_all_execs (void)
+{
+  size_t i;
+
+  lock_acquire (&exec_cache_lock);
+  for (i = 0; i < EXEC_CACHE_SIZE; i++)
+    if (exec_cache[i].inode != NULL)
+      exec_cache_drop (&exec_cache[i]);
+  lock_release (&exec_cache_lock);
+}
+
 /* load() helpers. */
 
 static bool install_page (void *upage, void *kpage, bool writable);
@@ -608,24 +1084,104 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   return true;
 }
 
-/* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+/* Largest argument block that may be placed on a new process's
+   stack. */
+#define ARGS_MAX (4 * PGSIZE)
+
+/* Counts the space-separated words in CMD_LINE, storing their
+   number in *ARGC and the bytes they take up, counting a null
+   terminator for each, in *STR_SIZE.  Returns false if the
+   arguments would not fit in ARGS_MAX bytes. */
 static bool
-setup_stack (void **esp)
+count_args (const char *cmd_line, int *argc, size_t *str_size)
 {
-  uint8_t *kpage;
-  bool success = false;
+  const char *p = cmd_line + strspn (cmd_line, " ");
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL)
+  *argc = 0;
+  *str_size = 0;
+  while (*p != '\0')
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
-        *esp = PHYS_BASE;
-      else
-        palloc_free_page (kpage);
+      size_t len = strcspn (p, " ");
+      ++*argc;
+      *str_size += len + 1;
+      p += len;
+      p += strspn (p, " ");
     }
-  return success;
+  return args_size (*argc, *str_size) <= ARGS_MAX;
+}
+
+/* Returns the number of bytes of stack taken up by ARGC
+   arguments of STR_SIZE bytes in total: the strings, padding to
+   a word boundary, argv[] with its null terminator, argv, argc
+   and a return address. */
+static size_t
+args_size (int argc, size_t str_size)
+{
+  return ROUND_UP (str_size, sizeof (char *))
+         + (argc + 1) * sizeof (char *)
+         + sizeof (char **) + sizeof (int) + sizeof (void *);
+}
+
+/* Pushes the ARGC words of CMD_LINE, STR_SIZE bytes in total as
+   computed by count_args(), onto the user stack at *ESP, in the
+   layout expected by _start(), updates *ESP and returns argv.
+   The strings and argv[] are written in a single pass over
+   CMD_LINE.  The stack pages must already be mapped and the
+   process's page directory active. */
+static char **
+push_args (const char *cmd_line, int argc, size_t str_size, void **esp)
+{
+  char *str = (char *) *esp - str_size;
+  char **argv = (char **) ROUND_DOWN ((uintptr_t) str, sizeof (char *))
+                - (argc + 1);
+  const char *p = cmd_line + strspn (cmd_line, " ");
+  uint32_t *sp = (uint32_t *) argv;
+  int i;
+
+  for (i = 0; i < argc; i++)
+    {
+      size_t len = strcspn (p, " ");
+      memcpy (str, p, len);
+      str[len] = '\0';
+      argv[i] = str;
+      str += len + 1;
+      p += len;
+      p += strspn (p, " ");
+    }
+  argv[argc] = NULL;
+
+  *--sp = (uint32_t) argv;
+  *--sp = argc;
+  *--sp = 0;                          /* Fake return address. */
+  *esp = sp;
+  return argv;
+}
+
+/* Create a minimal stack by mapping enough zeroed pages at the
+   top of user virtual memory to hold SIZE bytes of arguments,
+   plus a whole page more for the program's own use, since the
+   stack does not grow. */
+static bool
+setup_stack (void **esp, size_t size)
+{
+  size_t page_cnt = DIV_ROUND_UP (size, PGSIZE) + 1;
+  uint8_t *upage = PHYS_BASE;
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+      upage -= PGSIZE;
+      if (kpage == NULL)
+        return false;
+      if (!install_page (upage, kpage, true))
+        {
+          palloc_free_page (kpage);
+          return false;
+        }
+    }
+  *esp = PHYS_BASE;
+  return true;
 }
 
 /* Adds a mapping from user virtual address UPAGE to kernel
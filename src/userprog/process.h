@@ -3,9 +3,19 @@
 
 #include "threads/thread.h"
 
+struct inode;
+struct intr_frame;
+
+void process_init (void);
 tid_t process_execute (const char *file_name);
+tid_t process_execute_async (const char *file_name);
+int process_exec_status (tid_t);
+tid_t process_fork (const struct intr_frame *);
 int process_wait (tid_t);
+tid_t process_wait_any (int *status);
 void process_exit (void);
 void process_activate (void);
+void process_forget_exec (struct inode *);
+void process_forget_all_execs (void);
 
 #endif /* userprog/process.h */
@@ -0,0 +1,121 @@
+#include "userprog/rlimit.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads/thread.h"
+
+/* Names of resources, as used in -rlimit options and in usage
+   reports. */
+static const char *res_names[RES_CNT] =
+  {"frames", "kpages", "files", "reads", "writes", "ticks"};
+
+/* Limits on each resource, set with the kernel command-line
+   option "-rlimit=RESOURCE=SOFT[:HARD]".  A process that goes
+   over a soft limit gets a warning on the console.  A process
+   cannot go over a hard limit: the allocation fails instead, or
+   for ticks, the process is killed the next time an external
+   interrupt, such as the timer's, returns to it in user mode.
+   0 means no limit. */
+static int64_t soft_limit[RES_CNT];
+static int64_t hard_limit[RES_CNT];
+
+/* If true, each process prints its resource usage when it
+   exits.  Set with the kernel command-line option "-rusage". */
+bool rusage_report;
+
+/* Parses OPTION, of the form "RESOURCE=SOFT[:HARD]", and sets
+   the limits on RESOURCE accordingly.  Returns false if OPTION is
+   malformed. */
+bool
+rlimit_parse (const char *option)
+{
+  const char *value;
+  size_t len;
+  int i;
+
+  if (option == NULL || (value = strchr (option, '=')) == NULL)
+    return false;
+  len = value - option;
+  value++;
+
+  for (i = 0; i < RES_CNT; i++)
+    if (strlen (res_names[i]) == len && !memcmp (option, res_names[i], len))
+      {
+        const char *colon = strchr (value, ':');
+        soft_limit[i] = atoi (value);
+        hard_limit[i] = colon != NULL ? atoi (colon + 1) : 0;
+        return true;
+      }
+  return false;
+}
+
+/* Returns true if the running thread is a user process, to which
+   limits apply.  Kernel threads are only counted. */
+static bool
+is_limited (void)
+{
+  return thread_current ()->pagedir != NULL;
+}
+
+/* Charges AMOUNT more of resource RES to the running process.
+   Returns true if successful, false if that would put it over
+   its hard limit, in which case nothing is charged. */
+bool
+res_charge (enum resource res, int64_t amount)
+{
+  struct thread *t = thread_current ();
+  struct rusage *u = &t->rusage;
+  int64_t new_cur = u->cur[res] + amount;
+
+  if (is_limited () && hard_limit[res] > 0 && new_cur > hard_limit[res])
+    return false;
+
+  u->cur[res] = new_cur;
+  if (new_cur > u->peak[res])
+    u->peak[res] = new_cur;
+
+  if (is_limited () && soft_limit[res] > 0 && new_cur > soft_limit[res]
+      && !(u->warned & (1u << res)))
+    {
+      u->warned |= 1u << res;
+      printf ("%s: over soft limit of %"PRId64" %s\n",
+              t->name, soft_limit[res], res_names[res]);
+    }
+  return true;
+}
+
+/* Gives back AMOUNT of resource RES charged to the running
+   process. */
+void
+res_release (enum resource res, int64_t amount)
+{
+  thread_current ()->rusage.cur[res] -= amount;
+}
+
+/* Returns true if the running process is over its hard limit
+   on resource RES.  Used for resources that are counted where
+   nothing can be refused, such as ticks. */
+bool
+res_over_limit (enum resource res)
+{
+  return (is_limited () && hard_limit[res] > 0
+          && thread_current ()->rusage.cur[res] > hard_limit[res]);
+}
+
+/* Prints the running process's resource usage, if enabled with
+   "-rusage".  For each resource, the highest use is reported. */
+void
+rusage_print (void)
+{
+  struct thread *t = thread_current ();
+  int i;
+
+  if (!rusage_report)
+    return;
+
+  printf ("%s: usage:", t->name);
+  for (i = 0; i < RES_CNT; i++)
+    printf (" %s=%"PRId64, res_names[i], t->rusage.peak[i]);
+  printf ("\n");
+}
@@ -0,0 +1,35 @@
+#ifndef USERPROG_RLIMIT_H
+#define USERPROG_RLIMIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Resources whose use is tracked per process. */
+enum resource
+  {
+    RES_FRAMES,                 /* User pages mapped. */
+    RES_KPAGES,                 /* Page directory and page table pages. */
+    RES_FILES,                  /* Open files. */
+    RES_READS,                  /* File system sectors read. */
+    RES_WRITES,                 /* File system sectors written. */
+    RES_TICKS,                  /* Timer ticks spent running. */
+    RES_CNT                     /* Number of resources. */
+  };
+
+/* A process's use of each resource. */
+struct rusage
+  {
+    int64_t cur[RES_CNT];       /* Current use. */
+    int64_t peak[RES_CNT];      /* Highest use so far. */
+    unsigned warned;            /* Bit per resource over its soft limit. */
+  };
+
+extern bool rusage_report;
+
+bool rlimit_parse (const char *);
+bool res_charge (enum resource, int64_t amount);
+void res_release (enum resource, int64_t amount);
+bool res_over_limit (enum resource);
+void rusage_print (void);
+
+#endif /* userprog/rlimit.h */
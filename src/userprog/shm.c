@@ -0,0 +1,312 @@
+#include "userprog/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Range of user virtual addresses at which regions are
+   attached.  It lies well above any program's segments and well
+   below its stack. */
+#define SHM_BASE ((uint8_t *) 0x40000000)
+#define SHM_TOP ((uint8_t *) 0x80000000)
+
+/* A named region of shared anonymous memory.
+
+   The region owns the reference to each of its frames that
+   palloc handed out, and every page directory that maps one of
+   them holds another, so a frame is freed only once the region
+   and all of its mappings are gone.  The region itself goes
+   away, and its name becomes free for reuse, when the last
+   process detaches from it. */
+struct shm_region
+  {
+    struct list_elem elem;              /* Element in regions. */
+    char name[SHM_NAME_MAX + 1];        /* Name. */
+    size_t page_cnt;                    /* Number of pages. */
+    int attach_cnt;                     /* Number of attachments. */
+    void *frames[];                     /* Kernel addresses of frames. */
+  };
+
+/* A region attached to a process, in that process's list of
+   attachments, which is kept in order of address. */
+struct shm_map
+  {
+    struct shm_map *next;               /* Next attachment. */
+    struct shm_region *region;          /* Region attached. */
+    uint8_t *addr;                      /* User address of first page. */
+  };
+
+/* All regions, protected by regions_lock. */
+static struct list regions;
+static struct lock regions_lock;
+
+static struct shm_region *find_region (const char *name);
+static struct shm_region *create_region (const char *name, size_t page_cnt);
+static void put_region (struct shm_region *);
+static uint8_t *find_space (struct thread *, size_t page_cnt);
+static void unmap_region (uint32_t *pd, struct shm_map *);
+
+/* Initializes the shared memory regions. */
+void
+shm_init (void)
+{
+  list_init (&regions);
+  lock_init (&regions_lock);
+}
+
+/* Attaches the running process to the shared memory region
+   called NAME, creating it with PAGE_CNT zeroed pages if it does
+   not exist yet.  When attaching to an existing region,
+   PAGE_CNT must be 0 or the region's size.  Returns the user
+   address at which the region was mapped, or a null pointer on
+   failure. */
+void *
+shm_attach (const char *name, size_t page_cnt)
+{
+  struct thread *t = thread_current ();
+  struct shm_region *r;
+  struct shm_map *m, **mp;
+  size_t i;
+
+  if (strlen (name) > SHM_NAME_MAX)
+    return NULL;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return NULL;
+
+  lock_acquire (&regions_lock);
+  r = find_region (name);
+  if (r != NULL && page_cnt != 0 && page_cnt != r->page_cnt)
+    r = NULL;
+  else if (r == NULL)
+    r = create_region (name, page_cnt);
+  if (r == NULL)
+    goto fail;
+  r->attach_cnt++;
+
+  m->region = r;
+  m->addr = find_space (t, r->page_cnt);
+  if (m->addr == NULL)
+    goto fail_put;
+  for (i = 0; i < r->page_cnt; i++)
+    if (!pagedir_share_page (t->pagedir, m->addr + i * PGSIZE,
+                             r->frames[i]))
+      {
+        while (i-- > 0)
+          pagedir_unmap (t->pagedir, m->addr + i * PGSIZE);
+        goto fail_put;
+      }
+  lock_release (&regions_lock);
+
+  for (mp = &t->shm_maps; *mp != NULL && (*mp)->addr < m->addr;
+       mp = &(*mp)->next)
+    continue;
+  m->next = *mp;
+  *mp = m;
+  return m->addr;
+
+ fail_put:
+  put_region (r);
+ fail:
+  lock_release (&regions_lock);
+  free (m);
+  return NULL;
+}
+
+/* Detaches the running process from the shared memory region
+   that it attached at ADDR.  Returns true if successful, false
+   if no region is attached at ADDR. */
+bool
+shm_detach (void *addr)
+{
+  struct thread *t = thread_current ();
+  struct shm_map **mp;
+
+  for (mp = &t->shm_maps; *mp != NULL; mp = &(*mp)->next)
+    if ((*mp)->addr == addr)
+      {
+        struct shm_map *m = *mp;
+        *mp = m->next;
+        unmap_region (t->pagedir, m);
+        free (m);
+        return true;
+      }
+  return false;
+}
+
+/* Gives the running process, which has just copied the page
+   directory of PARENT with pagedir_fork(), the same attachments
+   as PARENT.  The mappings themselves were copied along with
+   the rest of the page directory.  Returns true if successful,
+   false if memory allocation fails. */
+bool
+shm_fork (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+  struct shm_map **tail = &t->shm_maps;
+  struct shm_map *pm;
+
+  for (pm = parent->shm_maps; pm != NULL; pm = pm->next)
+    {
+      struct shm_map *m = malloc (sizeof *m);
+      if (m == NULL)
+        return false;
+      m->region = pm->region;
+      m->addr = pm->addr;
+
+      lock_acquire (&regions_lock);
+      m->region->attach_cnt++;
+      lock_release (&regions_lock);
+
+      m->next = NULL;
+      *tail = m;
+      tail = &m->next;
+    }
+  return true;
+}
+
+/* Detaches the running process from all of its shared memory
+   regions.  Called when the process exits, before its page
+   directory is destroyed. */
+void
+shm_exit (void)
+{
+  struct thread *t = thread_current ();
+
+  while (t->shm_maps != NULL)
+    {
+      struct shm_map *m = t->shm_maps;
+      t->shm_maps = m->next;
+      unmap_region (t->pagedir, m);
+      free (m);
+    }
+}
+
+/* Returns the region called NAME, or a null pointer if there is
+   none.  regions_lock must be held. */
+static struct shm_region *
+find_region (const char *name)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&regions); e != list_end (&regions);
+       e = list_next (e))
+    {
+      struct shm_region *r = list_entry (e, struct shm_region, elem);
+      if (!strcmp (r->name, name))
+        return r;
+    }
+  return NULL;
+}
+
+/* Creates a region called NAME with PAGE_CNT zeroed pages from
+   the user pool and no attachments.  Returns the new region, or
+   a null pointer if PAGE_CNT is out of range or memory
+   allocation fails.  regions_lock must be held. */
+static struct shm_region *
+create_region (const char *name, size_t page_cnt)
+{
+  struct shm_region *r;
+  size_t i;
+
+  if (page_cnt == 0 || page_cnt > SHM_PAGES_MAX)
+    return NULL;
+
+  r = malloc (sizeof *r + page_cnt * sizeof *r->frames);
+  if (r == NULL)
+    return NULL;
+  strlcpy (r->name, name, sizeof r->name);
+  r->page_cnt = page_cnt;
+  r->attach_cnt = 0;
+  for (i = 0; i < page_cnt; i++)
+    {
+      r->frames[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (r->frames[i] == NULL)
+        {
+          while (i-- > 0)
+            palloc_free_page (r->frames[i]);
+          free (r);
+          return NULL;
+        }
+    }
+  list_push_back (&regions, &r->elem);
+  return r;
+}
+
+/* Drops an attachment to R, destroying R if it was the last.
+   regions_lock must be held. */
+static void
+put_region (struct shm_region *r)
+{
+  size_t i;
+
+  ASSERT (r->attach_cnt > 0);
+  if (--r->attach_cnt > 0)
+    return;
+
+  list_remove (&r->elem);
+  for (i = 0; i < r->page_cnt; i++)
+    pagedir_release_frame (r->frames[i]);
+  free (r);
+}
+
+/* Returns the lowest user address in the shared memory range at
+   which PAGE_CNT consecutive pages are unmapped in T's page
+   directory, or a null pointer if there is no such address.
+
+   Only the gaps between T's attachments are considered, so the
+   search does not walk the whole range page by page.  A
+   candidate gap is still checked against the page directory,
+   since a program's own segments could also lie in the range. */
+static uint8_t *
+find_space (struct thread *t, size_t page_cnt)
+{
+  size_t size = page_cnt * PGSIZE;
+  struct shm_map *m = t->shm_maps;
+  uint8_t *start = SHM_BASE;
+
+  while ((size_t) (SHM_TOP - start) >= size)
+    {
+      size_t i;
+
+      if (m != NULL && m->addr < start + size)
+        {
+          /* M overlaps the candidate, or lies below it. */
+          uint8_t *end = m->addr + m->region->page_cnt * PGSIZE;
+          if (end > start)
+            start = end;
+          m = m->next;
+          continue;
+        }
+
+      for (i = 0; i < page_cnt; i++)
+        if (pagedir_get_page (t->pagedir, start + i * PGSIZE) != NULL)
+          break;
+      if (i == page_cnt)
+        return start;
+      start += (i + 1) * PGSIZE;
+    }
+  return NULL;
+}
+
+/* Unmaps the region attached by M from PD and drops the
+   attachment. */
+static void
+unmap_region (uint32_t *pd, struct shm_map *m)
+{
+  size_t i;
+
+  if (pd != NULL)
+    for (i = 0; i < m->region->page_cnt; i++)
+      pagedir_unmap (pd, m->addr + i * PGSIZE);
+
+  lock_acquire (&regions_lock);
+  put_region (m->region);
+  lock_release (&regions_lock);
+}
@@ -0,0 +1,21 @@
+#ifndef USERPROG_SHM_H
+#define USERPROG_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct thread;
+
+/* Maximum length of a shared memory region's name. */
+#define SHM_NAME_MAX 31
+
+/* Maximum size of a shared memory region, in pages. */
+#define SHM_PAGES_MAX 256
+
+void shm_init (void);
+void *shm_attach (const char *name, size_t page_cnt);
+bool shm_detach (void *addr);
+bool shm_fork (struct thread *parent);
+void shm_exit (void);
+
+#endif /* userprog/shm.h */
@@ -1,46 +1,190 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include <sysring.h>
+#include <uio.h>
+#include "devices/input.h"
+#include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
+#include "filesys/directory.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "filesys/inode.h"
 #include "threads/vaddr.h"
+#include "userprog/fdtable.h"
+#include "userprog/futex.h"
 #include "userprog/pagedir.h"
+#include "userprog/pipe.h"
+#include "userprog/shm.h"
+#include "userprog/process.h"
+#include "userprog/rlimit.h"
 
 static void syscall_handler (struct intr_frame *);
+void seek (int fd, unsigned position);
+
+/* User memory access.
+
+   User memory is only ever touched through the accessors below,
+   which only make sure that a pointer lies below PHYS_BASE and
+   then let the MMU validate the access: if it faults, the page
+   fault handler (see userprog/exception.c) recognizes the
+   faulting instruction as one of theirs, resumes execution at
+   the recovery address that they leave in EAX and sets EAX to
+   -1 to report the failure.  File and pipe I/O goes through a
+   kernel bounce page, so that a fault never happens inside the
+   file system or a pipe with their locks held.
+
+   Buffers are also checked up front with validate_user_range(),
+   which looks at each page of the range once, so that a bad
+   buffer is rejected before any I/O is done on its behalf.  The
+   accessors still catch what that check cannot rule out, such as
+   a copy-on-write page that cannot be copied. */
+
+/* Returns true if the SIZE bytes starting at user address UADDR
+   lie entirely below PHYS_BASE. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  return (uintptr_t) uaddr + size >= (uintptr_t) uaddr
+         && (uintptr_t) uaddr + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* The accessors' faulting instructions are labeled, so that the
+   page fault handler can tell a fault there from any other
+   kernel fault on a user address.  Each label must appear only
+   once in the kernel, hence noinline and noclone. */
+
+/* Reads a byte at user virtual address UADDR, which must be
+   below PHYS_BASE.
+   Returns the byte value if successful, -1 if a segfault
+   occurred. */
+static int __attribute__ ((noinline, noclone))
+get_user (const uint8_t *uaddr)
+{
+  int result;
+  asm ("movl $1f, %0; .globl user_get_insn; "
+       "user_get_insn: movzbl %1, %0; 1:"
+       : "=&a" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Writes BYTE to user address UDST, which must be below
+   PHYS_BASE.
+   Returns true if successful, false if a segfault occurred. */
+static bool __attribute__ ((noinline, noclone))
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int error_code;
+  asm ("movl $1f, %0; .globl user_put_insn; "
+       "user_put_insn: movb %b2, %1; 1:"
+       : "=&a" (error_code), "=m" (*udst) : "q" (byte));
+  return error_code != -1;
+}
+
+/* Copies SIZE bytes from SRC to DST with a single `rep movsb',
+   recovering from a page fault on either side.
+   Returns true if successful, false if a segfault occurred. */
+static bool __attribute__ ((noinline, noclone))
+copy_bytes (void *dst, const void *src, size_t size)
+{
+  int error_code;
+  asm volatile ("movl $1f, %0; .globl user_copy_insn; "
+                "user_copy_insn: rep movsb; 1:"
+                : "=&a" (error_code), "+D" (dst), "+S" (src), "+c" (size)
+                : : "memory");
+  return error_code != -1;
+}
 
+/* Copies SIZE bytes from user address USRC to kernel address
+   KDST.  Returns true if successful, false if any part of the
+   source is not mapped user memory. */
 static bool
-is_valid_ptr(const void *p) {
-  struct thread *t = thread_current();
-  // Checks if p is null, if p is a valid uaddr and if p is mapped in that order
-  return ((p != NULL) && (is_user_vaddr(p) && (pagedir_get_page(t->pagedir, p) != NULL)));
+copy_from_user (void *kdst, const void *usrc, size_t size)
+{
+  return is_user_range (usrc, size) && copy_bytes (kdst, usrc, size);
 }
 
+/* Copies SIZE bytes from kernel address KSRC to user address
+   UDST.  Returns true if successful, false if any part of the
+   destination is not mapped, writable user memory. */
 static bool
-is_valid_str(const char *s) {
-  char c = *s;
-  int i = 0;
-
-  while(c != '\0') {
-    if (is_valid_ptr(s + i)) {        //validate every letter in string.
-	   c = *(s + i++);
-       }
-    else
-	   return false;
-  }
-  return true;
+copy_to_user (void *udst, const void *ksrc, size_t size)
+{
+  return is_user_range (udst, size) && copy_bytes (udst, ksrc, size);
 }
 
+/* Copies the null-terminated string at user address USRC into
+   the SIZE-byte kernel buffer KDST.
+   Returns the length of the string if successful, SIZE if the
+   string (including its null terminator) does not fit in KDST,
+   or -1 if the string runs into unmapped memory. */
+static int
+strncpy_from_user (char *kdst, const char *usrc, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    {
+      int c;
+
+      if ((uintptr_t) (usrc + i) >= (uintptr_t) PHYS_BASE)
+        return -1;
+      c = get_user ((const uint8_t *) usrc + i);
+      if (c == -1)
+        return -1;
+      kdst[i] = c;
+      if (c == '\0')
+        return i;
+    }
+  return size;
+}
+
+/* Copies the string at user address USTR into a newly allocated
+   page and returns it; the caller must free it with
+   palloc_free_page().  Kills the process if USTR is not a valid
+   user string.  Strings that do not fit in a page are truncated
+   to an empty string, which no file system operation accepts. */
+static char *
+copy_in_string (const char *ustr)
+{
+  char *kstr;
+  int len;
+
+  kstr = palloc_get_page (0);
+  if (kstr == NULL)
+    exit(-1);
+
+  len = strncpy_from_user (kstr, ustr, PGSIZE);
+  if (len == -1)
+    {
+      palloc_free_page (kstr);
+      exit(-1);
+    }
+  if (len == PGSIZE)
+    kstr[0] = '\0';
+  return kstr;
+}
+
+/* Returns true if the SIZE-byte user buffer BUF is mapped, and
+   also writable if WRITABLE is true. */
 static bool
-is_valid_buf(const void *buf, size_t size) {
-  unsigned i;
-  for (i = 0; i <= size; ++i) {
-    if(!is_valid_ptr(buf + i))
-      return false;
-  }
-  return true;
+is_valid_buf (const void *buf, size_t size, bool writable)
+{
+  return validate_user_range (thread_current ()->pagedir, buf, size,
+                              writable);
+}
+
+/* Copies the system call number and the following ARG_CNT
+   argument words from the user stack at F->esp into ARG.
+   Kills the process if the stack is not valid user memory. */
+static void
+get_args (struct intr_frame *f, int *arg, size_t arg_cnt)
+{
+  if (!copy_from_user (arg, f->esp, (arg_cnt + 1) * sizeof *arg))
+    exit(-1);
 }
 
 void
@@ -54,100 +198,378 @@ void halt(void){
 }
 
 bool create (const char *file, unsigned initial_size){
-    /*
-    why doesn't if(is_valid_ptr(file) && is_valid_str(file)) work?
-    */
-    if (is_valid_ptr(file) && is_valid_str(file))
-        return filesys_create(file, initial_size);
-    exit(-1);
-    return false;
+    char *name = copy_in_string(file);
+    bool success = filesys_create(name, initial_size);
+    palloc_free_page(name);
+    return success;
 }
 
 int open (const char *file){
-    if (!is_valid_ptr(file) || !is_valid_str(file))
-        exit(-1);
-    else {
-        struct thread *t = thread_current();
-        struct file *file_ptr = filesys_open(file);
-        if (file_ptr) {
-            int i;
-            for (i = 0; i<MAX_FILES; ++i) {
-                if (t->files[i] == NULL) {
-                    t->files[i] = file_ptr;
-                    return i+OFFSET;
-                }
-            }
-        }
+    struct thread *t = thread_current();
+    char *name = copy_in_string(file);
+    struct file *file_ptr = filesys_open(name);
+    palloc_free_page(name);
+    if (file_ptr == NULL)
+        return -1;
+
+    // directories get a struct dir of their own, for readdir()
+    enum fd_type type = FD_FILE;
+    void *obj = file_ptr;
+    struct inode *inode = file_get_inode(file_ptr);
+    if (inode_is_dir(inode)) {
+        type = FD_DIR;
+        obj = dir_open(inode_reopen(inode));
         file_close(file_ptr);
+        if (obj == NULL)
+            return -1;
     }
+
+    if (t->fds == NULL)
+        t->fds = fd_table_create();
+    if (t->fds != NULL && res_charge(RES_FILES, 1)) {
+        int fd = fd_table_add(t->fds, type, obj);
+        if (fd != -1)
+            return fd;
+        res_release(RES_FILES, 1);
+    }
+    if (type == FD_DIR)
+        dir_close(obj);
+    else
+        file_close(obj);
     return -1;
 }
 
-void close(int fd) {
+static void close(int fd) {
     struct thread *t = thread_current();
+    if (fd_table_close(t->fds, fd))
+        res_release(RES_FILES, 1);
+}
+
+static bool pipe (int fds[2]) {
+    if (!is_valid_buf(fds, 2 * sizeof *fds, true))
+        exit(-1);
+
+    struct thread *t = thread_current();
+    if (t->fds == NULL)
+        t->fds = fd_table_create();
+    if (t->fds == NULL || !res_charge(RES_FILES, 2))
+        return false;
+
+    struct pipe *p = pipe_create();
+    int rfd = -1, wfd = -1;
+    if (p != NULL) {
+        rfd = fd_table_add(t->fds, FD_PIPE_READ, p);
+        if (rfd == -1)
+            pipe_close(p, false);
+        wfd = fd_table_add(t->fds, FD_PIPE_WRITE, p);
+        if (wfd == -1)
+            pipe_close(p, true);
+    }
+    if (rfd == -1 || wfd == -1) {
+        if (rfd != -1)
+            fd_table_close(t->fds, rfd);
+        if (wfd != -1)
+            fd_table_close(t->fds, wfd);
+        res_release(RES_FILES, 2);
+        return false;
+    }
+
+    int kfds[2] = {rfd, wfd};
+    if (!copy_to_user(fds, kfds, sizeof kfds))
+        exit(-1);
+    return true;
+}
+
+/* Reads up to SIZE bytes into user BUFFER from pipe P if it is
+   non-null, otherwise from FILE at position POS, or at its
+   current position if POS is -1.  The data passes through a
+   kernel bounce page.  Returns the number of bytes read, or -1
+   if the bounce page cannot be allocated.  Kills the process if
+   BUFFER turns out to be bad. */
+static int
+read_to_user (struct file *file, struct pipe *p, off_t pos,
+              void *buffer, unsigned size)
+{
+    uint8_t *kbuf = palloc_get_page(0);
+    if (kbuf == NULL)
+        return -1;
+
+    unsigned bytes_read = 0;
+    while (bytes_read < size) {
+        unsigned chunk = size - bytes_read < PGSIZE ? size - bytes_read : PGSIZE;
+        int n;
+        if (p != NULL)
+            n = pipe_read(p, kbuf, chunk);
+        else if (pos != -1)
+            n = file_read_at(file, kbuf, chunk, pos + bytes_read);
+        else
+            n = file_read(file, kbuf, chunk);
+        if (!copy_to_user((uint8_t*)buffer + bytes_read, kbuf, n)) {
+            palloc_free_page(kbuf);
+            exit(-1);
+        }
+        bytes_read += n;
+
+        /* A pipe returns what it has, and waiting for more
+           could block a reader that already has data. */
+        if ((unsigned) n < chunk || p != NULL)
+            break;
+    }
+    palloc_free_page(kbuf);
+    return bytes_read;
+}
+
+/* Writes SIZE bytes from user BUFFER to pipe P if it is
+   non-null, otherwise to FILE at position POS, or at its current
+   position if POS is -1, or to the console if FILE is null too.
+   The data passes through a kernel bounce page.  Returns the
+   number of bytes written, or -1 if nothing could be written.
+   Kills the process if BUFFER turns out to be bad. */
+static int
+write_from_user (struct file *file, struct pipe *p, off_t pos,
+                 const void *buffer, unsigned size)
+{
+    uint8_t *kbuf = palloc_get_page(0);
+    if (kbuf == NULL)
+        return -1;
 
-    if (fd >= OFFSET && fd < MAX_FILES + OFFSET) {
-        struct file *file_ptr = t->files[fd-OFFSET];
+    unsigned bytes_written = 0;
+    while (bytes_written < size) {
+        unsigned chunk = size - bytes_written < PGSIZE ? size - bytes_written : PGSIZE;
+        if (!copy_from_user(kbuf, (const uint8_t*)buffer + bytes_written, chunk)) {
+            palloc_free_page(kbuf);
+            exit(-1);
+        }
 
-        if (file_ptr) {
-            file_close(file_ptr);
-            t->files[fd-OFFSET] = NULL;
+        int n = chunk;
+        if (p != NULL)
+            n = pipe_write(p, kbuf, chunk);
+        else if (file == NULL)
+            putbuf((char*)kbuf, chunk);
+        else if (pos != -1)
+            n = file_write_at(file, kbuf, chunk, pos + bytes_written);
+        else
+            n = file_write(file, kbuf, chunk);
+        if (n < 0) {
+            palloc_free_page(kbuf);
+            return bytes_written > 0 ? (int) bytes_written : -1;
         }
+        bytes_written += n;
+        if ((unsigned) n < chunk)
+            break;
     }
+    palloc_free_page(kbuf);
+    return bytes_written;
 }
 
 int read (int fd, void *buffer, unsigned size){
-    if(!is_valid_buf(buffer, size) || !is_valid_ptr(buffer))
+    if (!is_valid_buf(buffer, size, true))
         exit(-1);
-    else {
-        if (fd == 0) {
-            int bytes_read;
-            for (bytes_read = 0;  bytes_read < size; ++bytes_read) {
-                char c = input_getc();
-                *(char*)buffer = c;
-                (char*)buffer++;
-            }
-            return bytes_read;
+
+    if (fd == 0) {
+        unsigned bytes_read;
+        for (bytes_read = 0; bytes_read < size; ++bytes_read) {
+            if (!put_user((uint8_t*)buffer + bytes_read, input_getc()))
+                exit(-1);
         }
+        return bytes_read;
+    }
+
+    struct file *file_ptr = fd_table_get(thread_current()->fds, fd, FD_FILE);
+    if (file_ptr)
+        return read_to_user(file_ptr, NULL, -1, buffer, size);
+    struct pipe *p = fd_table_get(thread_current()->fds, fd, FD_PIPE_READ);
+    if (p)
+        return read_to_user(NULL, p, -1, buffer, size);
+    return -1;
+}
+
+int write (int fd, const void *buffer, unsigned size){
+    if (!is_valid_buf(buffer, size, false))
+        exit(-1);
 
-        struct thread *t = thread_current();
-        if (fd >= OFFSET && fd < MAX_FILES + OFFSET) {
-            struct file *file_ptr = t->files[fd-OFFSET];
+    if (fd == 1)
+        return write_from_user(NULL, NULL, -1, buffer, size);
 
-            if (file_ptr)
-                return file_read(file_ptr, buffer, size);
+    struct file *file_ptr = fd_table_get(thread_current()->fds, fd, FD_FILE);
+    if (file_ptr)
+        return write_from_user(file_ptr, NULL, -1, buffer, size);
+    struct pipe *p = fd_table_get(thread_current()->fds, fd, FD_PIPE_WRITE);
+    if (p)
+        return write_from_user(NULL, p, -1, buffer, size);
+    return -1;
+}
+
+/* Number of iovecs readv() and writev() copy into the kernel at
+   a time, which bounds their use of the kernel stack. */
+#define IOV_BATCH 16
+
+/* Performs a read or write, as selected by IS_WRITE, for each of
+   the IOVCNT buffers described by the user array IOV in turn,
+   stopping early at a short transfer.  Returns the number of
+   bytes transferred, or -1 if the very first transfer fails. */
+static int
+transfer_vector (int fd, const struct iovec *iov, int iovcnt, bool is_write)
+{
+    struct iovec batch[IOV_BATCH];
+    int total = 0;
+    int i;
+
+    if (iovcnt < 0 || iovcnt > IOV_MAX)
+        return -1;
+
+    for (i = 0; i < iovcnt; ++i) {
+        struct iovec *v = &batch[i % IOV_BATCH];
+        if (i % IOV_BATCH == 0) {
+            int cnt = iovcnt - i < IOV_BATCH ? iovcnt - i : IOV_BATCH;
+            if (!copy_from_user(batch, iov + i, cnt * sizeof *batch))
+                exit(-1);
         }
+
+        int n = is_write ? write(fd, v->iov_base, v->iov_len)
+                         : read(fd, v->iov_base, v->iov_len);
+        if (n < 0)
+            return total > 0 ? total : -1;
+        total += n;
+        if ((size_t) n < v->iov_len)
+            break;
     }
+    return total;
+}
+
+static int readv (int fd, const struct iovec *iov, int iovcnt) {
+    return transfer_vector(fd, iov, iovcnt, false);
+}
+
+static int writev (int fd, const struct iovec *iov, int iovcnt) {
+    return transfer_vector(fd, iov, iovcnt, true);
+}
+
+static int pread (int fd, void *buffer, unsigned size, unsigned position) {
+    if (!is_valid_buf(buffer, size, true))
+        exit(-1);
+
+    struct file *file_ptr = fd_table_get(thread_current()->fds, fd, FD_FILE);
+    if (file_ptr && (off_t) position >= 0)
+        return read_to_user(file_ptr, NULL, position, buffer, size);
     return -1;
 }
 
-int write (int fd, const void *buffer, unsigned size){
-    if (!is_valid_buf(buffer, size) || !is_valid_ptr(buffer))
+static int pwrite (int fd, const void *buffer, unsigned size, unsigned position) {
+    if (!is_valid_buf(buffer, size, false))
         exit(-1);
-    else {
-        if (fd == 1) {
-            putbuf((char*)buffer, size);
-            return size;
+
+    struct file *file_ptr = fd_table_get(thread_current()->fds, fd, FD_FILE);
+    if (file_ptr && (off_t) position >= 0)
+        return write_from_user(file_ptr, NULL, position, buffer, size);
+    return -1;
+}
+
+static bool sysring_setup (struct sysring *ring) {
+    if (ring != NULL && (pg_ofs(ring) + sizeof *ring > PGSIZE
+                         || !is_valid_buf(ring, sizeof *ring, true)))
+        return false;
+    thread_current()->ring = ring;
+    return true;
+}
+
+/* Performs the operations queued in the calling process's
+   submission ring, in order, posting a completion for each, and
+   returns how many were performed.  Stops early if the
+   completion queue fills up.  The ring is unregistered if it is
+   no longer mapped or cannot be written. */
+static int
+sysring_drain (void)
+{
+    struct thread *t = thread_current();
+    struct sysring *ring = t->ring;
+    struct {
+        unsigned sq_head, sq_tail, cq_head, cq_tail;
+    } q;                        /* Copy of the indexes that start RING. */
+    int cnt = 0;
+
+    if (ring == NULL)
+        return 0;
+    if (!is_valid_buf(ring, sizeof *ring, true)
+        || !copy_from_user(&q, ring, sizeof q)) {
+        t->ring = NULL;
+        return 0;
+    }
+
+    while (q.sq_head != q.sq_tail && q.cq_tail - q.cq_head < SYSRING_ENTRIES) {
+        struct sysring_sqe sqe;
+        struct sysring_cqe cqe;
+        int result;
+
+        if (!copy_from_user(&sqe, &ring->sq[q.sq_head % SYSRING_ENTRIES],
+                            sizeof sqe)) {
+            t->ring = NULL;
+            break;
         }
 
-        struct thread *t = thread_current();
-        if (fd >= OFFSET && fd < MAX_FILES + OFFSET) {
-            struct file *file_ptr = t->files[fd-OFFSET];
+        switch (sqe.op) {
+            case SYSRING_READ:
+                result = read(sqe.fd, sqe.buf, sqe.size);
+                break;
+            case SYSRING_WRITE:
+                result = write(sqe.fd, sqe.buf, sqe.size);
+                break;
+            case SYSRING_SEEK:
+                seek(sqe.fd, sqe.size);
+                result = 0;
+                break;
+            case SYSRING_CREATE:
+                result = create(sqe.buf, sqe.size);
+                break;
+            default:
+                result = -1;
+                break;
+        }
 
-            if (file_ptr)
-                return file_write(file_ptr, buffer, size);
+        cqe.user_data = sqe.user_data;
+        cqe.result = result;
+        cnt++;
+        q.sq_head++;
+        if (!copy_to_user(&ring->cq[q.cq_tail++ % SYSRING_ENTRIES], &cqe,
+                          sizeof cqe)
+            || !copy_to_user(&ring->sq_head, &q.sq_head, sizeof q.sq_head)
+            || !copy_to_user(&ring->cq_tail, &q.cq_tail, sizeof q.cq_tail)) {
+            t->ring = NULL;
+            break;
         }
     }
-    return -1;
+    return cnt;
 }
 
 tid_t exec (const char *cmd_line) {
-    if (!is_valid_ptr(cmd_line) || !is_valid_str(cmd_line)) {
+    char *cmd = copy_in_string(cmd_line);
+    tid_t tid = *cmd != '\0' ? process_execute(cmd) : TID_ERROR;
+    palloc_free_page(cmd);
+    return tid;
+}
+
+static tid_t exec_async (const char *cmd_line) {
+    char *cmd = copy_in_string(cmd_line);
+    tid_t tid = *cmd != '\0' ? process_execute_async(cmd) : TID_ERROR;
+    palloc_free_page(cmd);
+    return tid;
+}
+
+static tid_t wait_any (int *status) {
+    int exit_status;
+    tid_t tid;
+
+    if (status != NULL && !is_valid_buf(status, sizeof *status, true))
         exit(-1);
-        return -1;
-    }
-    return process_execute(cmd_line);
+    tid = process_wait_any(&exit_status);
+    if (tid != TID_ERROR && status != NULL
+        && !copy_to_user(status, &exit_status, sizeof *status))
+        exit(-1);
+    return tid;
+}
 
+static int exec_status (tid_t pid) {
+    return process_exec_status(pid);
 }
 
 void exit (int status){
@@ -162,114 +584,245 @@ int wait (tid_t pid) {
 }
 
 void seek (int fd, unsigned position) {
-    struct thread *t = thread_current();
-    if (fd >= OFFSET && fd < MAX_FILES + OFFSET) {
-        struct file *file_ptr = t->files[fd-OFFSET];
-
-        if (file_ptr) {
-            if (position > file_length(file_ptr))
-                file_seek(file_ptr, file_length(file_ptr));
-            else
-                file_seek(file_ptr, position);
-        }
+    struct file *file_ptr = fd_table_get(thread_current()->fds, fd, FD_FILE);
+    if (file_ptr) {
+        if (position > (unsigned) file_length(file_ptr))
+            file_seek(file_ptr, file_length(file_ptr));
+        else
+            file_seek(file_ptr, position);
     }
 }
 
 unsigned tell (int fd) {
-    struct thread *t = thread_current();
-    if (fd >= OFFSET && fd < MAX_FILES + OFFSET) {
-        struct file *file_ptr = t->files[fd-OFFSET];
-
-        if (file_ptr)
-            return file_tell(file_ptr);
-    }
+    struct file *file_ptr = fd_table_get(thread_current()->fds, fd, FD_FILE);
+    if (file_ptr)
+        return file_tell(file_ptr);
+    return 0;
 }
 
 int filesize (int fd) {
-    struct thread *t = thread_current();
-    if (fd >= OFFSET && fd < MAX_FILES + OFFSET) {
-        struct file *file_ptr = t->files[fd-OFFSET];
-
-        if (file_ptr)
-            return file_length(file_ptr);
-    }
+    struct file *file_ptr = fd_table_get(thread_current()->fds, fd, FD_FILE);
+    if (file_ptr)
+        return file_length(file_ptr);
     return -1;
 }
 
 bool remove (const char *file_name) {
-    if (is_valid_ptr(file_name) && is_valid_str(file_name)) {
-        return filesys_remove(file_name);
-    }
-    exit(-1);
-    return false;
+    char *name = copy_in_string(file_name);
+    bool success = filesys_remove(name);
+    palloc_free_page(name);
+    return success;
 }
 
+static bool chdir (const char *dir) {
+    char *name = copy_in_string(dir);
+    bool success = filesys_chdir(name);
+    palloc_free_page(name);
+    return success;
+}
 
-static void
-syscall_handler (struct intr_frame *f UNUSED)
-{
-    if(!is_valid_ptr(f->esp))
+static bool mkdir (const char *dir) {
+    char *name = copy_in_string(dir);
+    bool success = filesys_mkdir(name);
+    palloc_free_page(name);
+    return success;
+}
+
+static bool readdir (int fd, char *name) {
+    if (!is_valid_buf(name, NAME_MAX + 1, true))
         exit(-1);
-    else {
-        int *arg = (int*)f->esp;
+    struct dir *dir = fd_table_get(thread_current()->fds, fd, FD_DIR);
+    char kname[NAME_MAX + 1];
+    if (dir == NULL || !dir_readdir(dir, kname))
+        return false;
+    if (!copy_to_user(name, kname, strlen(kname) + 1))
+        exit(-1);
+    return true;
+}
 
-        switch(arg[0]){
-            case SYS_HALT:
-                halt();
-                break;
-            case SYS_EXIT:
-                if(is_valid_ptr(&arg[1]))
-                    exit((int)arg[1]);
-                else
-                    exit(-1);
-                break;
-            case SYS_CREATE:
-                f->eax = create((char*)arg[1], (unsigned)arg[2]);
-                break;
-            case SYS_OPEN:
-                if(is_valid_ptr(&arg[1]))
-                    f->eax = open((char*)arg[1]);
-                else
-                    exit(-1);
-                break;
-            case SYS_READ:
-                f->eax = read((int)arg[1], (void*)arg[2], (unsigned)arg[3]);
-                break;
-            case SYS_WRITE:
-                f->eax = write((int)arg[1], (void*)arg[2], (unsigned)arg[3]);
-                break;
-            case SYS_CLOSE:
-                if(is_valid_ptr(&arg[1]))
-                    close((int)arg[1]);
-                else
-                    exit(-1);
-                break;
-            case SYS_EXEC:
-                f->eax = exec((char*)arg[1]);
-                break;
-            case SYS_WAIT:
-                if(is_valid_ptr(&arg[1]))
-                    f->eax = wait((tid_t)arg[1]);
-                else
-                    exit(-1);
-                break;
-            case SYS_SEEK:
-                seek((int)arg[1], (unsigned)arg[2]);
-                break;
-            case SYS_TELL:
-                f->eax = tell((int)arg[1]);
-                break;
-            case SYS_FILESIZE:
-                f->eax = filesize((int)arg[1]);
-                break;
-            case SYS_REMOVE:
-                if(is_valid_ptr(&arg[1]))
-                    f->eax = remove((char*)arg[1]);
-                else
-                    exit(-1);
-                break;
-            default:
-                break;
-        }
+static bool isdir (int fd) {
+    return fd_table_get(thread_current()->fds, fd, FD_DIR) != NULL;
+}
+
+static int inumber (int fd) {
+    struct fd_table *fds = thread_current()->fds;
+    struct file *file_ptr = fd_table_get(fds, fd, FD_FILE);
+    if (file_ptr)
+        return inode_get_inumber(file_get_inode(file_ptr));
+    struct dir *dir = fd_table_get(fds, fd, FD_DIR);
+    if (dir)
+        return inode_get_inumber(dir_get_inode(dir));
+    return -1;
+}
+
+/* The sys_ prefix keeps this apart from shm_attach() in
+   userprog/shm.c, which does the work. */
+static void *sys_shm_attach (const char *name, size_t page_cnt) {
+    char *kname = copy_in_string(name);
+    void *addr = shm_attach(kname, page_cnt);
+    palloc_free_page(kname);
+    return addr;
+}
+
+/* Likewise for futex_wait() and futex_wake() in userprog/futex.c. */
+static int sys_futex_wait (int *addr, int expected) {
+    if (!is_valid_buf(addr, sizeof *addr, false))
+        exit(-1);
+    return futex_wait(addr, expected);
+}
+
+static int sys_futex_wake (int *addr, int wake_cnt) {
+    if (!is_valid_buf(addr, sizeof *addr, false))
+        exit(-1);
+    return futex_wake(addr, wake_cnt);
+}
+
+static void
+syscall_handler (struct intr_frame *f)
+{
+    int arg[5];
+
+    /* Fetch the system call number; each case below then fetches
+       exactly as many argument words as it needs. */
+    get_args(f, arg, 0);
+
+    /* Any system call first performs the operations queued in the
+       process's submission ring, so that they happen before
+       whatever the process asks for next. */
+    if (arg[0] != SYS_SYSRING_ENTER)
+        sysring_drain();
+
+    switch(arg[0]){
+        case SYS_HALT:
+            halt();
+            break;
+        case SYS_EXIT:
+            get_args(f, arg, 1);
+            exit(arg[1]);
+            break;
+        case SYS_CREATE:
+            get_args(f, arg, 2);
+            f->eax = create((char*)arg[1], (unsigned)arg[2]);
+            break;
+        case SYS_OPEN:
+            get_args(f, arg, 1);
+            f->eax = open((char*)arg[1]);
+            break;
+        case SYS_READ:
+            get_args(f, arg, 3);
+            f->eax = read(arg[1], (void*)arg[2], (unsigned)arg[3]);
+            break;
+        case SYS_WRITE:
+            get_args(f, arg, 3);
+            f->eax = write(arg[1], (void*)arg[2], (unsigned)arg[3]);
+            break;
+        case SYS_CLOSE:
+            get_args(f, arg, 1);
+            close(arg[1]);
+            break;
+        case SYS_EXEC:
+            get_args(f, arg, 1);
+            f->eax = exec((char*)arg[1]);
+            break;
+        case SYS_WAIT:
+            get_args(f, arg, 1);
+            f->eax = wait((tid_t)arg[1]);
+            break;
+        case SYS_SEEK:
+            get_args(f, arg, 2);
+            seek(arg[1], (unsigned)arg[2]);
+            break;
+        case SYS_TELL:
+            get_args(f, arg, 1);
+            f->eax = tell(arg[1]);
+            break;
+        case SYS_FILESIZE:
+            get_args(f, arg, 1);
+            f->eax = filesize(arg[1]);
+            break;
+        case SYS_REMOVE:
+            get_args(f, arg, 1);
+            f->eax = remove((char*)arg[1]);
+            break;
+        case SYS_CHDIR:
+            get_args(f, arg, 1);
+            f->eax = chdir((char*)arg[1]);
+            break;
+        case SYS_MKDIR:
+            get_args(f, arg, 1);
+            f->eax = mkdir((char*)arg[1]);
+            break;
+        case SYS_READDIR:
+            get_args(f, arg, 2);
+            f->eax = readdir(arg[1], (char*)arg[2]);
+            break;
+        case SYS_ISDIR:
+            get_args(f, arg, 1);
+            f->eax = isdir(arg[1]);
+            break;
+        case SYS_INUMBER:
+            get_args(f, arg, 1);
+            f->eax = inumber(arg[1]);
+            break;
+        case SYS_READV:
+            get_args(f, arg, 3);
+            f->eax = readv(arg[1], (struct iovec*)arg[2], arg[3]);
+            break;
+        case SYS_WRITEV:
+            get_args(f, arg, 3);
+            f->eax = writev(arg[1], (struct iovec*)arg[2], arg[3]);
+            break;
+        case SYS_PREAD:
+            get_args(f, arg, 4);
+            f->eax = pread(arg[1], (void*)arg[2], (unsigned)arg[3], (unsigned)arg[4]);
+            break;
+        case SYS_PWRITE:
+            get_args(f, arg, 4);
+            f->eax = pwrite(arg[1], (void*)arg[2], (unsigned)arg[3], (unsigned)arg[4]);
+            break;
+        case SYS_SYSRING_SETUP:
+            get_args(f, arg, 1);
+            f->eax = sysring_setup((struct sysring*)arg[1]);
+            break;
+        case SYS_SYSRING_ENTER:
+            f->eax = sysring_drain();
+            break;
+        case SYS_FORK:
+            f->eax = process_fork(f);
+            break;
+        case SYS_EXEC_ASYNC:
+            get_args(f, arg, 1);
+            f->eax = exec_async((char*)arg[1]);
+            break;
+        case SYS_EXEC_STATUS:
+            get_args(f, arg, 1);
+            f->eax = exec_status(arg[1]);
+            break;
+        case SYS_WAIT_ANY:
+            get_args(f, arg, 1);
+            f->eax = wait_any((int*)arg[1]);
+            break;
+        case SYS_PIPE:
+            get_args(f, arg, 1);
+            f->eax = pipe((int*)arg[1]);
+            break;
+        case SYS_SHM_ATTACH:
+            get_args(f, arg, 2);
+            f->eax = (uint32_t)sys_shm_attach((char*)arg[1], (size_t)arg[2]);
+            break;
+        case SYS_SHM_DETACH:
+            get_args(f, arg, 1);
+            f->eax = shm_detach((void*)arg[1]);
+            break;
+        case SYS_FUTEX_WAIT:
+            get_args(f, arg, 2);
+            f->eax = sys_futex_wait((int*)arg[1], arg[2]);
+            break;
+        case SYS_FUTEX_WAKE:
+            get_args(f, arg, 2);
+            f->eax = sys_futex_wake((int*)arg[1], arg[2]);
+            break;
+        default:
+            break;
     }
 }
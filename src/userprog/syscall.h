@@ -1,9 +1,15 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
+
+#include <debug.h>
+
 void syscall_init (void);
-void close(int fd);
-#endif /* userprog/syscall.h */
+void exit (int status) NO_RETURN;
 
+/* The instructions in the user memory accessors that may fault
+   on a bad user address. */
+extern const char user_get_insn[];
+extern const char user_put_insn[];
+extern const char user_copy_insn[];
 
-#define MAX_FILES 128
-#define OFFSET 2
+#endif /* userprog/syscall.h */